@@ -3,14 +3,39 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Requests for up to this many sectors in total, adjacent on
+   disk and in the same direction, are merged into one. */
+#define MERGE_PAGES 4
+#define MERGE_SECTORS (MERGE_PAGES * PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A request waiting in a block device's queue. */
+struct block_request
+  {
+    struct list_elem elem;              /* Element in queue. */
+    block_sector_t sector;              /* First sector. */
+    size_t cnt;                         /* Number of sectors. */
+    bool write;                         /* Write (true) or read? */
+    void *buffer;                       /* Data, CNT sectors. */
+    int64_t submitted;                  /* timer_ticks() at submission. */
+    struct semaphore done;              /* Up'd on completion. */
+  };
+
+/* Size of a block device's name, including the null terminator. */
+#define BLOCK_NAME_LEN 16
 
 /* A block device. */
 struct block
   {
     struct list_elem list_elem;         /* Element in all_blocks. */
 
-    char name[16];                      /* Block device name. */
+    char name[BLOCK_NAME_LEN];          /* Block device name. */
     enum block_type type;                /* Type of block device. */
     block_sector_t size;                 /* Size in sectors. */
 
@@ -19,6 +44,21 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+
+    /* Request queue, unless ops->forwards. */
+    struct lock queue_lock;             /* Protects queue and queue_depth. */
+    struct condition queue_nonempty;    /* Signaled when a request arrives. */
+    struct list queue;                  /* Pending requests, by sector. */
+    size_t queue_depth;                 /* Number of pending requests. */
+    block_sector_t head;                /* Sector after last dispatch. */
+    uint8_t *merge_buffer;              /* MERGE_PAGES pages, or null. */
+
+    unsigned long long request_cnt;     /* Number of requests submitted. */
+    unsigned long long dispatch_cnt;    /* Number of driver calls. */
+    unsigned long long merge_cnt;       /* Requests merged into others. */
+    unsigned long long depth_sum;       /* Sum of queue depths at submit. */
+    size_t max_depth;                   /* Maximum queue depth. */
+    unsigned long long latency_sum;     /* Sum of ticks to completion. */
   };
 
 /* List of all block devices. */
@@ -28,6 +68,9 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static void block_submit (struct block *, block_sector_t, size_t cnt,
+                          bool write, void *buffer);
+static void block_io_thread (void *block_);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -121,8 +164,7 @@ void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
   check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  block_submit (block, sector, 1, false, buffer);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -135,8 +177,243 @@ block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  block_submit (block, sector, 1, true, (void *) buffer);
+}
+
+/* Reads the CNT consecutive sectors starting at SECTOR from
+   BLOCK into BUFFER, which must have room for CNT *
+   BLOCK_SECTOR_SIZE bytes.  Returns after all of them have been
+   read.  Uses a single multi-sector request if the driver
+   supports it. */
+void
+block_read_multiple (struct block *block, block_sector_t sector, size_t cnt,
+                     void *buffer)
+{
+  if (cnt == 0)
+    return;
+  check_sector (block, sector);
+  check_sector (block, sector + cnt - 1);
+  block_submit (block, sector, cnt, false, buffer);
+}
+
+/* Writes the CNT consecutive sectors starting at SECTOR to BLOCK
+   from BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block device has acknowledged receiving all
+   of them.  Uses a single multi-sector request if the driver
+   supports it. */
+void
+block_write_multiple (struct block *block, block_sector_t sector, size_t cnt,
+                      const void *buffer)
+{
+  if (cnt == 0)
+    return;
+  check_sector (block, sector);
+  check_sector (block, sector + cnt - 1);
+  ASSERT (block->type != BLOCK_FOREIGN);
+  block_submit (block, sector, cnt, true, (void *) buffer);
+}
+
+/* Transfers CNT sectors starting at SECTOR between BLOCK and
+   BUFFER by calling its driver directly, with a single
+   multi-sector call if the driver supports it. */
+static void
+block_transfer (struct block *block, block_sector_t sector, size_t cnt,
+                bool write, void *buffer_)
+{
+  uint8_t *buffer = buffer_;
+  size_t i;
+
+  if (cnt > 1 && write && block->ops->write_multiple != NULL)
+    block->ops->write_multiple (block->aux, sector, cnt, buffer);
+  else if (cnt > 1 && !write && block->ops->read_multiple != NULL)
+    block->ops->read_multiple (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      if (write)
+        block->ops->write (block->aux, sector + i,
+                           buffer + i * BLOCK_SECTOR_SIZE);
+      else
+        block->ops->read (block->aux, sector + i,
+                          buffer + i * BLOCK_SECTOR_SIZE);
+
+  if (write)
+    block->write_cnt += cnt;
+  else
+    block->read_cnt += cnt;
+}
+
+/* Returns true if request A starts before request B. */
+static bool
+request_less (const struct list_elem *a_, const struct list_elem *b_,
+              void *aux UNUSED)
+{
+  const struct block_request *a = list_entry (a_, struct block_request, elem);
+  const struct block_request *b = list_entry (b_, struct block_request, elem);
+  return a->sector < b->sector;
+}
+
+/* Transfers CNT sectors starting at SECTOR between BLOCK and
+   BUFFER, and returns once the transfer is done.  Unless BLOCK
+   forwards its requests, queues the request for BLOCK's I/O
+   thread and waits for it.
+
+   BUFFER must be in kernel memory: the I/O thread, which accesses
+   it, does not run in the submitter's address space. */
+static void
+block_submit (struct block *block, block_sector_t sector, size_t cnt,
+              bool write, void *buffer)
+{
+  struct block_request r;
+
+  ASSERT (is_kernel_vaddr (buffer));
+
+  if (block->ops->forwards)
+    {
+      block_transfer (block, sector, cnt, write, buffer);
+      return;
+    }
+
+  r.sector = sector;
+  r.cnt = cnt;
+  r.write = write;
+  r.buffer = buffer;
+  r.submitted = timer_ticks ();
+  sema_init (&r.done, 0);
+
+  lock_acquire (&block->queue_lock);
+  list_insert_ordered (&block->queue, &r.elem, request_less, NULL);
+  block->queue_depth++;
+  block->request_cnt++;
+  block->depth_sum += block->queue_depth;
+  if (block->queue_depth > block->max_depth)
+    block->max_depth = block->queue_depth;
+  cond_signal (&block->queue_nonempty, &block->queue_lock);
+  lock_release (&block->queue_lock);
+
+  sema_down (&r.done);
+}
+
+/* Removes the next request to dispatch from BLOCK's queue,
+   together with the requests that follow it on disk and can be
+   merged into it, and moves them to BATCH.  Requests are taken in
+   C-LOOK order: the first one at or after the head, wrapping
+   around to the lowest sector when there is none.
+   BLOCK's queue must be locked and nonempty. */
+static void
+pick_requests (struct block *block, struct list *batch)
+{
+  struct list_elem *e;
+  struct block_request *first;
+  block_sector_t end;
+  size_t cnt;
+
+  ASSERT (lock_held_by_current_thread (&block->queue_lock));
+  ASSERT (!list_empty (&block->queue));
+
+  for (e = list_begin (&block->queue); e != list_end (&block->queue);
+       e = list_next (e))
+    if (list_entry (e, struct block_request, elem)->sector >= block->head)
+      break;
+  if (e == list_end (&block->queue))
+    e = list_begin (&block->queue);
+
+  first = list_entry (e, struct block_request, elem);
+  end = first->sector + first->cnt;
+  cnt = first->cnt;
+  e = list_remove (e);
+  list_push_back (batch, &first->elem);
+  block->queue_depth--;
+
+  while (e != list_end (&block->queue) && block->merge_buffer != NULL)
+    {
+      struct block_request *r = list_entry (e, struct block_request, elem);
+      if (r->sector != end || r->write != first->write
+          || cnt + r->cnt > MERGE_SECTORS)
+        break;
+      end += r->cnt;
+      cnt += r->cnt;
+      e = list_remove (e);
+      list_push_back (batch, &r->elem);
+      block->queue_depth--;
+      block->merge_cnt++;
+    }
+}
+
+/* Dispatches the adjacent requests in BATCH to BLOCK's driver as
+   a single transfer, then wakes up their submitters. */
+static void
+dispatch_requests (struct block *block, struct list *batch)
+{
+  struct block_request *first
+    = list_entry (list_front (batch), struct block_request, elem);
+  struct list_elem *e;
+  block_sector_t end;
+  int64_t now;
+
+  if (list_size (batch) == 1)
+    {
+      block_transfer (block, first->sector, first->cnt, first->write,
+                      first->buffer);
+      end = first->sector + first->cnt;
+    }
+  else
+    {
+      /* Gather into or scatter from the merge buffer. */
+      uint8_t *p = block->merge_buffer;
+      if (first->write)
+        for (e = list_begin (batch); e != list_end (batch); e = list_next (e))
+          {
+            struct block_request *r = list_entry (e, struct block_request, elem);
+            memcpy (p, r->buffer, r->cnt * BLOCK_SECTOR_SIZE);
+            p += r->cnt * BLOCK_SECTOR_SIZE;
+          }
+      end = list_entry (list_back (batch), struct block_request, elem)->sector
+            + list_entry (list_back (batch), struct block_request, elem)->cnt;
+      block_transfer (block, first->sector, end - first->sector,
+                      first->write, block->merge_buffer);
+      if (!first->write)
+        for (e = list_begin (batch); e != list_end (batch); e = list_next (e))
+          {
+            struct block_request *r = list_entry (e, struct block_request, elem);
+            memcpy (r->buffer, p, r->cnt * BLOCK_SECTOR_SIZE);
+            p += r->cnt * BLOCK_SECTOR_SIZE;
+          }
+    }
+  block->head = end;
+  block->dispatch_cnt++;
+
+  /* Each request lives on its submitter's stack, so it must not
+     be touched once its submitter is woken. */
+  now = timer_ticks ();
+  for (e = list_begin (batch); e != list_end (batch); )
+    {
+      struct block_request *r = list_entry (e, struct block_request, elem);
+      e = list_next (e);
+      block->latency_sum += now - r->submitted;
+      sema_up (&r->done);
+    }
+}
+
+/* BLOCK's I/O thread, which services its request queue. */
+static void
+block_io_thread (void *block_)
+{
+  struct block *block = block_;
+
+  block->merge_buffer = palloc_get_multiple (0, MERGE_PAGES);
+  for (;;)
+    {
+      struct list batch;
+
+      list_init (&batch);
+      lock_acquire (&block->queue_lock);
+      while (list_empty (&block->queue))
+        cond_wait (&block->queue_nonempty, &block->queue_lock);
+      pick_requests (block, &batch);
+      lock_release (&block->queue_lock);
+
+      dispatch_requests (block, &batch);
+    }
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -164,11 +441,12 @@ block_type (struct block *block)
 void
 block_print_stats (void)
 {
+  struct block *block;
   int i;
 
   for (i = 0; i < BLOCK_ROLE_CNT; i++)
     {
-      struct block *block = block_by_role[i];
+      block = block_by_role[i];
       if (block != NULL)
         {
           printf ("%s (%s): %llu reads, %llu writes\n",
@@ -176,6 +454,21 @@ block_print_stats (void)
                   block->read_cnt, block->write_cnt);
         }
     }
+
+  /* Request queues are on the disks, not their partitions. */
+  for (block = block_first (); block != NULL; block = block_next (block))
+    if (!block->ops->forwards && block->request_cnt > 0)
+      {
+        unsigned long long depth = block->depth_sum * 100 / block->request_cnt;
+        unsigned long long latency
+          = block->latency_sum * 100 / block->request_cnt;
+        printf ("%s queue: %llu requests, %llu merged, %llu dispatched, "
+                "depth %llu.%02llu avg %zu max, "
+                "latency %llu.%02llu ticks avg\n",
+                block->name, block->request_cnt, block->merge_cnt,
+                block->dispatch_cnt, depth / 100, depth % 100,
+                block->max_depth, latency / 100, latency % 100);
+      }
 }
 
 /* Registers a new block device with the given NAME.  If
@@ -201,6 +494,16 @@ block_register (const char *name, enum block_type type,
   block->read_cnt = 0;
   block->write_cnt = 0;
 
+  lock_init (&block->queue_lock);
+  cond_init (&block->queue_nonempty);
+  list_init (&block->queue);
+  block->queue_depth = 0;
+  block->head = 0;
+  block->merge_buffer = NULL;
+  block->request_cnt = block->dispatch_cnt = block->merge_cnt = 0;
+  block->depth_sum = block->latency_sum = 0;
+  block->max_depth = 0;
+
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
   printf (")");
@@ -208,6 +511,15 @@ block_register (const char *name, enum block_type type,
     printf (", %s", extra_info);
   printf ("\n");
 
+  if (!ops->forwards)
+    {
+      char thread_name[BLOCK_NAME_LEN + 3];
+      snprintf (thread_name, sizeof thread_name, "%s-io", block->name);
+      if (thread_create (thread_name, PRI_DEFAULT, block_io_thread, block)
+          == TID_ERROR)
+        PANIC ("%s: failed to start I/O thread", block->name);
+    }
+
   return block;
 }
 
@@ -3,15 +3,22 @@
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/block.h"
 #include "devices/partition.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   Besides single-sector PIO, it supports multi-sector transfers
+   with READ/WRITE MULTIPLE and, if the controller found on the
+   PCI bus is capable of it, bus master DMA [SFF-8038i]. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -34,6 +41,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +57,44 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Maximum number of sectors transferred by a single command. */
+#define MAX_COMMAND_SECTORS 256
+
+/* Bus master IDE port addresses. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table. */
+
+/* Bus master Command Register bits. */
+#define BM_CMD_START 0x01       /* Start transfer. */
+#define BM_CMD_READ 0x08        /* Transfer from device to memory. */
+
+/* Bus master Status Register bits. */
+#define BM_STA_ERROR 0x02       /* Transfer failed (write 1 to clear). */
+#define BM_STA_INTR 0x04        /* Interrupt raised (write 1 to clear). */
+
+/* A Physical Region Descriptor, which describes one physically
+   contiguous memory region of a DMA transfer.  The regions of a
+   transfer are listed in a PRD table, ended by PRD_EOT. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address. */
+    uint16_t size;              /* Size in bytes, 0 meaning 64 kB. */
+    uint16_t flags;             /* PRD_EOT for the last region. */
+  };
+#define PRD_EOT 0x8000
+
+/* Size of each channel's DMA buffer.  DMA transfers go through
+   it, since it is physically contiguous, unlike the buffers of
+   callers which may be in user memory. */
+#define DMA_PAGES 8
+#define DMA_SECTORS (DMA_PAGES * PGSIZE / BLOCK_SECTOR_SIZE)
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +103,10 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+
+    int multiple_sectors;       /* Sectors per READ/WRITE MULTIPLE
+                                   block, 0 if not supported. */
+    bool dma;                   /* Does it support DMA? */
   };
 
 /* An ATA channel (aka controller).
@@ -72,6 +122,10 @@ struct channel
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+    uint16_t bm_base;           /* Bus master base I/O port, 0 if none. */
+    struct prd *prdt;           /* PRD table, for DMA. */
+    uint8_t *dma_buffer;        /* DMA_PAGES pages, for DMA. */
+
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
 
@@ -81,14 +135,20 @@ static struct channel channels[CHANNEL_CNT];
 
 static struct block_operations ide_operations;
 
+/* Preferred transfer mode; each disk uses the best mode up to
+   this one that it supports. */
+static enum ide_xfer_mode ide_xfer_mode = IDE_XFER_DMA;
+
+static uint16_t find_bus_master (void);
+static void setup_dma (struct channel *);
+
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void select_sectors (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
-static void output_sector (struct channel *, const void *);
 
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
@@ -101,6 +161,7 @@ static void interrupt_handler (struct intr_frame *);
 void
 ide_init (void) 
 {
+  uint16_t bm_base = find_bus_master ();
   size_t chan_no;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
@@ -126,6 +187,9 @@ ide_init (void)
       lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      c->bm_base = bm_base != 0 ? bm_base + chan_no * 8 : 0;
+      c->prdt = NULL;
+      c->dma_buffer = NULL;
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +200,8 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->multiple_sectors = 0;
+          d->dma = false;
         }
 
       /* Register interrupt handler. */
@@ -152,6 +218,129 @@ ide_init (void)
       for (dev_no = 0; dev_no < 2; dev_no++)
         if (c->devices[dev_no].is_ata)
           identify_ata_device (&c->devices[dev_no]);
+
+      /* Set up DMA, if any disk can use it. */
+      if (c->bm_base != 0
+          && (c->devices[0].dma || c->devices[1].dma))
+        setup_dma (c);
+    }
+}
+
+/* Selects the preferred transfer MODE.  Returns false if no disk
+   supports MODE, in which case disks fall back to the best mode
+   they support. */
+bool
+ide_set_xfer_mode (enum ide_xfer_mode mode)
+{
+  size_t chan_no;
+  int dev_no;
+  bool supported = mode == IDE_XFER_PIO;
+
+  ide_xfer_mode = mode;
+  for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
+    for (dev_no = 0; dev_no < 2; dev_no++)
+      {
+        struct channel *c = &channels[chan_no];
+        struct ata_disk *d = &c->devices[dev_no];
+        if (!d->is_ata)
+          continue;
+        if (mode == IDE_XFER_PIO_MULTIPLE && d->multiple_sectors > 0)
+          supported = true;
+        if (mode == IDE_XFER_DMA && d->dma && c->dma_buffer != NULL)
+          supported = true;
+      }
+  return supported;
+}
+
+/* Returns the transfer mode disk D uses. */
+static enum ide_xfer_mode
+disk_xfer_mode (const struct ata_disk *d)
+{
+  if (ide_xfer_mode >= IDE_XFER_DMA && d->dma
+      && d->channel->dma_buffer != NULL)
+    return IDE_XFER_DMA;
+  if (ide_xfer_mode >= IDE_XFER_PIO_MULTIPLE && d->multiple_sectors > 0)
+    return IDE_XFER_PIO_MULTIPLE;
+  return IDE_XFER_PIO;
+}
+
+/* PCI bus master detection. */
+
+/* PCI configuration space access ports. */
+#define PCI_CONFIG_ADDRESS 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+
+/* Returns the 32-bit register at offset REG in the configuration
+   space of PCI function BUS:DEV.FUNC. */
+static uint32_t
+pci_read_config (int bus, int dev, int func, int reg)
+{
+  outl (PCI_CONFIG_ADDRESS,
+        0x80000000 | (bus << 16) | (dev << 11) | (func << 8) | (reg & 0xfc));
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Sets the 32-bit register at offset REG in the configuration
+   space of PCI function BUS:DEV.FUNC to VALUE. */
+static void
+pci_write_config (int bus, int dev, int func, int reg, uint32_t value)
+{
+  outl (PCI_CONFIG_ADDRESS,
+        0x80000000 | (bus << 16) | (dev << 11) | (func << 8) | (reg & 0xfc));
+  outl (PCI_CONFIG_DATA, value);
+}
+
+/* Looks for an IDE controller capable of bus mastering on PCI
+   bus 0, such as the PIIX emulated by QEMU and Bochs, and enables
+   bus mastering on it.  Returns the base I/O port of its bus
+   master registers (those of the secondary channel are 8 ports
+   above), or 0 if there is no such controller. */
+static uint16_t
+find_bus_master (void)
+{
+  int dev, func;
+
+  for (dev = 0; dev < 32; dev++)
+    for (func = 0; func < 8; func++)
+      {
+        uint32_t id = pci_read_config (0, dev, func, 0x00);
+        uint32_t class = pci_read_config (0, dev, func, 0x08);
+        uint32_t bar4;
+
+        if ((id & 0xffff) == 0xffff)
+          continue;
+
+        /* Class 01h (mass storage), subclass 01h (IDE), with
+           programming interface bit 7 set (bus master capable). */
+        if ((class >> 16) != 0x0101 || !(class & 0x8000))
+          continue;
+
+        /* BAR4 holds the bus master I/O ports. */
+        bar4 = pci_read_config (0, dev, func, 0x20);
+        if (!(bar4 & 1) || (bar4 & 0xfffc) == 0)
+          continue;
+
+        /* Enable I/O space and bus master accesses. */
+        pci_write_config (0, dev, func, 0x04,
+                          pci_read_config (0, dev, func, 0x04) | 0x5);
+        return bar4 & 0xfffc;
+      }
+  return 0;
+}
+
+/* Allocates channel C's PRD table and DMA buffer.  Leaves C
+   without DMA if memory is short. */
+static void
+setup_dma (struct channel *c)
+{
+  c->prdt = palloc_get_page (0);
+  c->dma_buffer = palloc_get_multiple (0, DMA_PAGES);
+  if (c->prdt == NULL || c->dma_buffer == NULL)
+    {
+      palloc_free_page (c->prdt);
+      palloc_free_multiple (c->dma_buffer, DMA_PAGES);
+      c->prdt = NULL;
+      c->dma_buffer = NULL;
     }
 }
 
@@ -281,6 +470,10 @@ identify_ata_device (struct ata_disk *d)
     }
   input_sector (c, id);
 
+  /* Check for multi-sector transfers and DMA (words 47 and 49). */
+  d->multiple_sectors = *(uint16_t *) &id[47 * 2] & 0xff;
+  d->dma = (*(uint16_t *) &id[49 * 2] & (1 << 8)) != 0;
+
   /* Calculate capacity.
      Read model name and serial number. */
   capacity = *(uint32_t *) &id[60 * 2];
@@ -303,6 +496,19 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
+  /* Enable READ/WRITE MULTIPLE with the largest block size the
+     disk supports. */
+  if (d->multiple_sectors > 0)
+    {
+      select_device_wait (d);
+      outb (reg_nsect (c), d->multiple_sectors);
+      issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+      sema_down (&c->completion_wait);
+      wait_while_busy (d);
+      if (inb (reg_status (c)) & STA_ERR)
+        d->multiple_sectors = 0;
+    }
+
   /* Register. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
@@ -337,6 +543,102 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER
+   in PIO mode, BLOCK sectors per interrupt.  BLOCK must be 1, or
+   D's multiple_sectors for READ MULTIPLE. */
+static void
+pio_read (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+          uint8_t *buffer, size_t block)
+{
+  struct channel *c = d->channel;
+  size_t i;
+
+  select_sectors (d, sec_no, cnt);
+  issue_pio_command (c, block > 1 ? CMD_READ_MULTIPLE : CMD_READ_SECTOR_RETRY);
+  for (i = 0; i < cnt; i += block)
+    {
+      size_t n = cnt - i < block ? cnt - i : block;
+      sema_down (&c->completion_wait);
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no + i);
+      insw (reg_data (c), buffer + i * BLOCK_SECTOR_SIZE,
+            n * BLOCK_SECTOR_SIZE / 2);
+    }
+}
+
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER in
+   PIO mode, BLOCK sectors per interrupt.  BLOCK must be 1, or D's
+   multiple_sectors for WRITE MULTIPLE. */
+static void
+pio_write (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+           const uint8_t *buffer, size_t block)
+{
+  struct channel *c = d->channel;
+  size_t i;
+
+  select_sectors (d, sec_no, cnt);
+  issue_pio_command (c, block > 1 ? CMD_WRITE_MULTIPLE : CMD_WRITE_SECTOR_RETRY);
+  for (i = 0; i < cnt; i += block)
+    {
+      size_t n = cnt - i < block ? cnt - i : block;
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no + i);
+      outsw (reg_data (c), buffer + i * BLOCK_SECTOR_SIZE,
+             n * BLOCK_SECTOR_SIZE / 2);
+      sema_down (&c->completion_wait);
+    }
+}
+
+/* Transfers CNT sectors, at most DMA_SECTORS, starting at SEC_NO
+   between disk D and its channel's DMA buffer, by bus master
+   DMA.  Reads from the disk if WRITE is false. */
+static void
+dma_transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+              bool write)
+{
+  struct channel *c = d->channel;
+  uint8_t direction = write ? 0 : BM_CMD_READ;
+  uintptr_t addr = vtop (c->dma_buffer);
+  size_t left = cnt * BLOCK_SECTOR_SIZE;
+  uint8_t bm_status;
+  int i;
+
+  ASSERT (cnt <= DMA_SECTORS);
+
+  /* Describe the DMA buffer.  A region may not cross a 64 kB
+     boundary. */
+  for (i = 0; left > 0; i++)
+    {
+      size_t size = 0x10000 - (addr & 0xffff);
+      if (size > left)
+        size = left;
+      c->prdt[i].addr = addr;
+      c->prdt[i].size = size & 0xffff;
+      c->prdt[i].flags = 0;
+      addr += size;
+      left -= size;
+    }
+  c->prdt[i - 1].flags = PRD_EOT;
+
+  /* Program the bus master, issue the command, start the
+     transfer and wait for its completion interrupt. */
+  outb (reg_bm_command (c), direction);
+  outl (reg_bm_prdt (c), vtop (c->prdt));
+  outb (reg_bm_status (c),
+        inb (reg_bm_status (c)) | BM_STA_ERROR | BM_STA_INTR);
+  select_sectors (d, sec_no, cnt);
+  issue_pio_command (c, write ? CMD_WRITE_DMA : CMD_READ_DMA);
+  outb (reg_bm_command (c), direction | BM_CMD_START);
+  sema_down (&c->completion_wait);
+  outb (reg_bm_command (c), direction);
+
+  bm_status = inb (reg_bm_status (c));
+  outb (reg_bm_status (c), bm_status | BM_STA_ERROR | BM_STA_INTR);
+  if ((bm_status & BM_STA_ERROR) || (inb (reg_alt_status (c)) & STA_ERR))
+    PANIC ("%s: disk DMA %s failed, sector=%"PRDSNu,
+           d->name, write ? "write" : "read", sec_no);
+}
+
 /* Reads sector SEC_NO from disk D into BUFFER, which must have
    room for BLOCK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to disks, so external
@@ -347,12 +649,7 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
+  pio_read (d, sec_no, 1, buffer, 1);
   lock_release (&c->lock);
 }
 
@@ -367,33 +664,113 @@ ide_write (void *d_, block_sector_t sec_no, const void *buffer)
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
+  pio_write (d, sec_no, 1, buffer, 1);
+  lock_release (&c->lock);
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes, with as
+   few commands as D's transfer mode allows.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                   void *buffer_)
+{
+  struct ata_disk *d = d_;
+  struct channel *c = d->channel;
+  uint8_t *buffer = buffer_;
+
+  lock_acquire (&c->lock);
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_COMMAND_SECTORS ? cnt : MAX_COMMAND_SECTORS;
+      switch (disk_xfer_mode (d))
+        {
+        case IDE_XFER_DMA:
+          if (n > DMA_SECTORS)
+            n = DMA_SECTORS;
+          dma_transfer (d, sec_no, n, false);
+          memcpy (buffer, c->dma_buffer, n * BLOCK_SECTOR_SIZE);
+          break;
+        case IDE_XFER_PIO_MULTIPLE:
+          pio_read (d, sec_no, n, buffer, d->multiple_sectors);
+          break;
+        default:
+          n = 1;
+          pio_read (d, sec_no, n, buffer, 1);
+          break;
+        }
+      sec_no += n;
+      buffer += n * BLOCK_SECTOR_SIZE;
+      cnt -= n;
+    }
+  lock_release (&c->lock);
+}
+
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes, with as few
+   commands as D's transfer mode allows.  Returns after the disk
+   has acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_write_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                    const void *buffer_)
+{
+  struct ata_disk *d = d_;
+  struct channel *c = d->channel;
+  const uint8_t *buffer = buffer_;
+
+  lock_acquire (&c->lock);
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_COMMAND_SECTORS ? cnt : MAX_COMMAND_SECTORS;
+      switch (disk_xfer_mode (d))
+        {
+        case IDE_XFER_DMA:
+          if (n > DMA_SECTORS)
+            n = DMA_SECTORS;
+          memcpy (c->dma_buffer, buffer, n * BLOCK_SECTOR_SIZE);
+          dma_transfer (d, sec_no, n, true);
+          break;
+        case IDE_XFER_PIO_MULTIPLE:
+          pio_write (d, sec_no, n, buffer, d->multiple_sectors);
+          break;
+        default:
+          n = 1;
+          pio_write (d, sec_no, n, buffer, 1);
+          break;
+        }
+      sec_no += n;
+      buffer += n * BLOCK_SECTOR_SIZE;
+      cnt -= n;
+    }
   lock_release (&c->lock);
 }
 
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple,
+    false                       /* Queued here. */
   };
-
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and CNT, the number of sectors to transfer, to
+   the disk's sector selection registers.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sectors (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt > 0 && cnt <= MAX_COMMAND_SECTORS);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt);    /* 0 means 256. */
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -402,7 +779,7 @@ select_sector (struct ata_disk *d, block_sector_t sec_no)
 }
 
 /* Writes COMMAND to channel C and prepares for receiving a
-   completion interrupt. */
+   completion interrupt.  (Used for DMA commands, too.) */
 static void
 issue_pio_command (struct channel *c, uint8_t command) 
 {
@@ -422,14 +799,6 @@ input_sector (struct channel *c, void *sector)
   insw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
 }
 
-/* Writes SECTOR to channel C's data register in PIO mode.
-   SECTOR must contain BLOCK_SECTOR_SIZE bytes. */
-static void
-output_sector (struct channel *c, const void *sector) 
-{
-  outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
-}
-
 /* Low-level ATA primitives. */
 
 /* Wait up to 10 seconds for the controller to become idle, that
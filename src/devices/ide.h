@@ -1,6 +1,17 @@
 #ifndef DEVICES_IDE_H
 #define DEVICES_IDE_H
 
+#include <stdbool.h>
+
+/* IDE transfer modes, from slowest to fastest. */
+enum ide_xfer_mode
+  {
+    IDE_XFER_PIO,               /* PIO, one command per sector. */
+    IDE_XFER_PIO_MULTIPLE,      /* PIO, READ/WRITE MULTIPLE. */
+    IDE_XFER_DMA                /* Bus master DMA. */
+  };
+
 void ide_init (void);
+bool ide_set_xfer_mode (enum ide_xfer_mode);
 
 #endif /* devices/ide.h */
@@ -3,6 +3,7 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include <list.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
@@ -20,6 +21,50 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Number of ticks handed to thread_tick() so far.  Trails TICKS
+   after a tickless stretch of idle time, until the next timer
+   interrupt catches up. */
+static int64_t ticks_done;
+
+/* PIT cycles in a timer tick. */
+#define TICK_CYCLES ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* The time-stamp counter (TSC) is the high-resolution clock.
+   TSC cycles per timer tick, initialized by timer_calibrate(),
+   and the TSC value when the current tick began. */
+#define TSC_CALIBRATE_TICKS 10
+static uint64_t tsc_per_tick;
+static uint64_t tick_tsc;
+
+/* Channel 0 of the PIT either interrupts periodically, once a
+   tick, or counts down once to the next event: the first pending
+   high-resolution timer, the next tick, or, while idle, the tick
+   at which the first sleeping thread is due.  Tick boundaries are
+   kept on the TSC in the latter case, so that they do not drift
+   however often the PIT is reprogrammed. */
+static bool periodic = true;
+
+/* Largest count of a one-shot PIT countdown, and the slack, in
+   PIT cycles, within which an event counts as reached (in TSC
+   cycles in tsc_slack). */
+#define ONESHOT_MAX 65535
+#define ONESHOT_SLACK 4
+static uint64_t tsc_slack;
+
+/* Pending high-resolution timers, in order of expiration. */
+static struct list hrtimers;
+
+bool timer_tickless;
+
+/* While idle with tickless idle, the tick the PIT is stopped
+   until, otherwise 0. */
+static int64_t idle_until;
+
+/* Statistics. */
+static long long interrupts;    /* Timer interrupts. */
+static long long hrtimers_fired; /* High-resolution timers expired. */
+static long long idle_stops;    /* Times the periodic timer was stopped. */
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -29,12 +74,16 @@ static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static uint64_t ns_to_tsc (int64_t ns);
+static void hrtimers_run (uint64_t now);
+static void timer_reprogram (void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void)
 {
+  list_init (&hrtimers);
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -44,6 +93,8 @@ void
 timer_calibrate (void)
 {
   unsigned high_bit, test_bit;
+  uint64_t start_tsc;
+  int64_t start;
 
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
@@ -63,7 +114,19 @@ timer_calibrate (void)
     if (!too_many_loops (high_bit | test_bit))
       loops_per_tick |= test_bit;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  /* Count TSC cycles over a few ticks of the PIT. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+  start_tsc = timer_tsc ();
+  start = ticks;
+  while (ticks < start + TSC_CALIBRATE_TICKS)
+    barrier ();
+  tsc_per_tick = (timer_tsc () - start_tsc) / TSC_CALIBRATE_TICKS;
+  tsc_slack = tsc_per_tick * ONESHOT_SLACK / TICK_CYCLES;
+
+  printf ("%'"PRIu64" loops/s, %'"PRIu64" TSC cycles/s.\n",
+          (uint64_t) loops_per_tick * TIMER_FREQ, tsc_per_tick * TIMER_FREQ);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -84,6 +147,30 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the CPU's time-stamp counter. */
+uint64_t
+timer_tsc (void)
+{
+  uint64_t tsc;
+
+  /* See [IA32-v2b] "RDTSC". */
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Returns the number of nanoseconds since the OS booted, at the
+   resolution of the TSC.  timer_calibrate() must have been
+   called. */
+int64_t
+timer_ns (void)
+{
+  uint64_t hz = tsc_per_tick * TIMER_FREQ;
+  uint64_t tsc = timer_tsc ();
+
+  ASSERT (tsc_per_tick != 0);
+  return tsc / hz * 1000000000 + tsc % hz * 1000000000 / hz;
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
@@ -164,19 +251,227 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Initializes high-resolution timer TIMER to call FUNC, passing
+   AUX, when it goes off. */
+void
+hrtimer_init (struct hrtimer *timer, hrtimer_func *func, void *aux)
+{
+  timer->func = func;
+  timer->aux = aux;
+  timer->pending = false;
+}
+
+/* Returns true if high-resolution timer A goes off before B. */
+static bool
+hrtimer_less (const struct list_elem *a_, const struct list_elem *b_,
+              void *aux UNUSED)
+{
+  const struct hrtimer *a = list_entry (a_, struct hrtimer, elem);
+  const struct hrtimer *b = list_entry (b_, struct hrtimer, elem);
+
+  return a->expires < b->expires;
+}
+
+/* Has TIMER go off NS nanoseconds from now.  Its function is
+   called from the timer interrupt handler, so it must not sleep.
+   If TIMER is pending, it is restarted.  timer_calibrate() must
+   have been called. */
+void
+hrtimer_start (struct hrtimer *timer, int64_t ns)
+{
+  enum intr_level old_level;
+
+  ASSERT (tsc_per_tick != 0);
+
+  old_level = intr_disable ();
+  if (timer->pending)
+    list_remove (&timer->elem);
+  timer->expires = timer_tsc () + ns_to_tsc (ns > 0 ? ns : 0);
+  timer->pending = true;
+  list_insert_ordered (&hrtimers, &timer->elem, hrtimer_less, NULL);
+  timer_reprogram ();
+  intr_set_level (old_level);
+}
+
+/* Stops TIMER.  Returns true if it was pending, false if it had
+   already gone off or was never started. */
+bool
+hrtimer_cancel (struct hrtimer *timer)
+{
+  enum intr_level old_level = intr_disable ();
+  bool pending = timer->pending;
+
+  if (pending)
+    {
+      list_remove (&timer->elem);
+      timer->pending = false;
+    }
+  intr_set_level (old_level);
+  return pending;
+}
+
+/* Called by the idle thread, with interrupts off, when it has
+   nothing to run and the first sleeping thread is due at
+   NEXT_TICK (or later).  With tickless idle, stops the periodic
+   timer until then, if that saves any interrupts. */
+void
+timer_idle_enter (int64_t next_tick)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || tsc_per_tick == 0 || next_tick - ticks < 2)
+    return;
+
+  idle_until = next_tick;
+  idle_stops++;
+  timer_reprogram ();
+}
+
+/* Called with interrupts off when the idle thread gives up the
+   CPU.  If the periodic timer was stopped, accounts for the
+   ticks that went by since and has the timer interrupt at the
+   next tick again.  The threads' per-tick work for those ticks is
+   done at that interrupt. */
+void
+timer_idle_exit (void)
+{
+  uint64_t now;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (idle_until == 0)
+    return;
+
+  idle_until = 0;
+  now = timer_tsc ();
+  while (now - tick_tsc >= tsc_per_tick)
+    {
+      ticks++;
+      tick_tsc += tsc_per_tick;
+    }
+  timer_reprogram ();
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void)
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  printf ("Timer: %lld interrupts, %lld high-resolution timers fired\n",
+          interrupts, hrtimers_fired);
+  if (timer_tickless)
+    printf ("Timer: stopped %lld times while idle\n", idle_stops);
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;
-  thread_tick ( timer_ticks() );
+  uint64_t now = timer_tsc ();
+
+  interrupts++;
+  if (periodic)
+    {
+      ticks++;
+      tick_tsc = now;
+    }
+  else
+    {
+      /* Count the ticks that began since the last interrupt. */
+      while (now + tsc_slack - tick_tsc >= tsc_per_tick)
+        {
+          ticks++;
+          tick_tsc += tsc_per_tick;
+        }
+    }
+
+  while (ticks_done < ticks)
+    thread_tick (++ticks_done);
+
+  if (tsc_per_tick != 0)
+    {
+      hrtimers_run (now);
+      timer_reprogram ();
+    }
+}
+
+/* Converts NS nanoseconds to TSC cycles. */
+static uint64_t
+ns_to_tsc (int64_t ns)
+{
+  uint64_t hz = tsc_per_tick * TIMER_FREQ;
+
+  return ns / 1000000000 * hz + ns % 1000000000 * hz / 1000000000;
+}
+
+/* Calls the functions of the high-resolution timers that have
+   gone off as of TSC value NOW, give or take a few PIT cycles. */
+static void
+hrtimers_run (uint64_t now)
+{
+  uint64_t limit = now + tsc_slack;
+
+  while (!list_empty (&hrtimers))
+    {
+      struct hrtimer *timer = list_entry (list_front (&hrtimers),
+                                          struct hrtimer, elem);
+      if (timer->expires > limit)
+        break;
+      list_pop_front (&hrtimers);
+      timer->pending = false;
+      hrtimers_fired++;
+      timer->func (timer->aux);
+    }
+}
+
+/* Programs channel 0 of the PIT for the next event, with
+   interrupts off.  Stays with, or goes back to, a periodic
+   interrupt when the next event is the next tick and the current
+   one has just begun. */
+static void
+timer_reprogram (void)
+{
+  uint64_t now = timer_tsc ();
+  uint64_t next = tick_tsc + tsc_per_tick;
+  uint64_t cycles;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (idle_until > ticks)
+    next = tick_tsc + (idle_until - ticks) * tsc_per_tick;
+  if (!list_empty (&hrtimers))
+    {
+      struct hrtimer *timer = list_entry (list_front (&hrtimers),
+                                          struct hrtimer, elem);
+      if (timer->expires < next)
+        next = timer->expires;
+    }
+
+  if (next == tick_tsc + tsc_per_tick)
+    {
+      if (periodic)
+        return;
+      /* Restarting the periodic interrupt lengthens the current
+         tick by the time it has already run, so only do that
+         early on in the tick. */
+      if (now - tick_tsc < tsc_per_tick / 16)
+        {
+          periodic = true;
+          tick_tsc = now;
+          pit_configure_channel (0, 2, TIMER_FREQ);
+          return;
+        }
+    }
+
+  /* Count down once to NEXT, or as far towards it as the PIT
+     can. */
+  cycles = next > now ? next - now : 0;
+  if (cycles > tsc_per_tick * ONESHOT_MAX / TICK_CYCLES)
+    cycles = ONESHOT_MAX;
+  else
+    cycles = cycles * TICK_CYCLES / tsc_per_tick;
+  periodic = false;
+  pit_start_countdown (0, cycles > 0 ? cycles : 1);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -212,6 +507,13 @@ busy_wait (int64_t loops)
     barrier ();
 }
 
+/* Unblocks the thread T, sleeping in real_time_sleep(). */
+static void
+wake_sleeper (void *t)
+{
+  thread_unblock (t);
+}
+
 /* Sleep for approximately NUM/DENOM seconds. */
 static void
 real_time_sleep (int64_t num, int32_t denom)
@@ -225,7 +527,21 @@ real_time_sleep (int64_t num, int32_t denom)
   int64_t ticks = num * TIMER_FREQ / denom;
 
   ASSERT (intr_get_level () == INTR_ON);
-  if (ticks > 0)
+  if (tsc_per_tick != 0)
+    {
+      /* Block until a high-resolution timer goes off. */
+      struct hrtimer timer;
+      enum intr_level old_level;
+
+      if (num <= 0)
+        return;
+      hrtimer_init (&timer, wake_sleeper, thread_current ());
+      old_level = intr_disable ();
+      hrtimer_start (&timer, num * (1000000000 / denom));
+      thread_block ();
+      intr_set_level (old_level);
+    }
+  else if (ticks > 0)
     {
       /* We're waiting for at least one full timer tick.  Use
          timer_sleep() because it will yield the CPU to other
@@ -1,18 +1,32 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Most ticks past the next one that tickless idle looks ahead
+   for sleeping threads.  The timer still interrupts every 65535
+   PIT cycles, about 55 ms, when idle for longer. */
+#define TIMER_IDLE_MAX (TIMER_FREQ / 4)
+
+/* Stop the periodic timer while idle?  Set with -tickless. */
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+/* High-resolution clock. */
+uint64_t timer_tsc (void);
+int64_t timer_ns (void);
+
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
@@ -24,6 +38,25 @@ void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+/* High-resolution timer. */
+typedef void hrtimer_func (void *aux);
+struct hrtimer
+  {
+    struct list_elem elem;      /* Element in list of pending timers. */
+    uint64_t expires;           /* TSC value at which it goes off. */
+    bool pending;               /* Started and not gone off yet? */
+    hrtimer_func *func;         /* Function to call. */
+    void *aux;                  /* Its argument. */
+  };
+
+void hrtimer_init (struct hrtimer *, hrtimer_func *, void *aux);
+void hrtimer_start (struct hrtimer *, int64_t ns);
+bool hrtimer_cancel (struct hrtimer *);
+
+/* Tickless idle. */
+void timer_idle_enter (int64_t next_tick);
+void timer_idle_exit (void);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
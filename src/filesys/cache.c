@@ -1,11 +1,30 @@
 #include <debug.h>
+#include <hash.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "filesys/cache.h"
 #include "filesys/filesys.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 #define BUFFER_CACHE_SIZE 64
 
+/* The cache is split into lock-striped shards, each owning a
+   fixed subset of the entries with its own lock, hash index and
+   clock hand.  A sector always maps to the same shard, so threads
+   touching sectors of different shards never contend. */
+#define BUFFER_CACHE_SHARDS 8
+#define BUFFER_CACHE_SHARD_SIZE (BUFFER_CACHE_SIZE / BUFFER_CACHE_SHARDS)
+
+/* Runs of 2^CLUSTER_SHIFT consecutive sectors map to the same
+   shard, so a sequential transfer stays within one lock. */
+#define BUFFER_CACHE_CLUSTER_SHIFT 3
+
 struct buffer_cache_entry_t {
   bool occupied;  // true only if this entry is valid cache entry
 
@@ -13,36 +32,166 @@ struct buffer_cache_entry_t {
   uint8_t buffer[BLOCK_SECTOR_SIZE];
 
   bool dirty;     // dirty bit
-  bool access;    // reference bit, for clock algorithm
+  bool access;    // reference bit, for clock algorithm; read hits set
+                  // it under the read lock (a single store, and only
+                  // the clock hand clears it, under the write lock)
+  bool busy;      // being written back by the write-behind daemon;
+                  // must not be evicted until the write completes
+  unsigned pin_cnt;   // number of outstanding buffer_cache_pin()s;
+                      // a pinned entry is neither evicted nor written behind
+  bool writing;   // pinned by buffer_cache_pin_mut(): the buffer may be
+                  // modified with no lock held, so nobody else may
+                  // access it until the pin goes away
+
+  struct hash_elem helem;   // see buffer_cache_shard::index
+};
+
+struct buffer_cache_shard {
+  struct rwlock lock;       // protects every member of this shard; read
+                            // hits only hold it for reading, which is
+                            // enough as long as the entry is not
+                            // `writing` (changed under the write lock)
+  struct hash index;        // disk_sector -> occupied entry
+  size_t clock;             // clock hand for eviction
+  struct condition io_done; // signaled when busy or pinned entries become idle
+
+  struct buffer_cache_entry_t entries[BUFFER_CACHE_SHARD_SIZE];
+
+  unsigned long long hit_cnt;   // statistics (see buffer_cache_count_hit())
+  unsigned long long miss_cnt;
+  unsigned long long readahead_cnt;
+  unsigned long long evict_write_cnt;
+  unsigned long long writebehind_cnt;
 };
 
-/* Buffer cache entries. */
-static struct buffer_cache_entry_t cache[BUFFER_CACHE_SIZE];
+/* Buffer cache shards. */
+static struct buffer_cache_shard shards[BUFFER_CACHE_SHARDS];
+
+/* Read-ahead.
+   Sectors requested through buffer_cache_readahead() are queued
+   here and fetched in the background by the read-ahead daemon.
+   The queue is bounded; requests that don't fit are dropped,
+   since read-ahead is only a hint. */
+#define READAHEAD_QUEUE_SIZE 64
+
+/* Number of sectors to prefetch ahead of a sequential reader.
+   Controlled by kernel command-line option "-ra=N"; 0 disables
+   read-ahead. */
+size_t buffer_cache_readahead_window = 8;
+
+static block_sector_t readahead_queue[READAHEAD_QUEUE_SIZE];
+static size_t readahead_head;         // index of the oldest request
+static size_t readahead_size;         // number of queued requests
+static bool readahead_running;        // false once the cache is closed,
+                                      // or if read-ahead is disabled
+static struct lock readahead_lock;    // protects the queue
+static struct condition readahead_cond;  // signaled on a new request
+
+static void buffer_cache_readahead_daemon (void *aux);
+
+/* Write-behind.
+   The write-behind daemon periodically writes back every dirty
+   entry, so that eviction rarely has to write on behalf of the
+   thread that needs a slot.  Dirty sectors are copied out under
+   the shard locks and written in ascending sector order with no
+   cache lock held. */
+
+/* Number of timer ticks between two write-behind passes.
+   Controlled by kernel command-line option "-wb=N"; 0 disables
+   write-behind. */
+unsigned buffer_cache_writebehind_interval = TIMER_FREQ;
+
+/* A sector copied out for write-behind. */
+struct writebehind_item {
+  block_sector_t sector;
+  uint8_t *data;
+};
+
+#define WRITEBEHIND_PAGES (BUFFER_CACHE_SIZE * BLOCK_SECTOR_SIZE / PGSIZE)
+
+static struct writebehind_item writebehind_batch[BUFFER_CACHE_SIZE];
+static uint8_t *writebehind_buffer;   // WRITEBEHIND_PAGES pages of copies
+static bool writebehind_running;      // false once the cache is closed
+
+/* Serializes write-behind passes with buffer_cache_close(), so
+   that an older copy of a sector is never written after a newer
+   one. */
+static struct lock writeback_lock;
+
+static void buffer_cache_writebehind_daemon (void *aux);
+
+static unsigned buffer_cache_hash_func (const struct hash_elem *, void *);
+static bool buffer_cache_less_func (const struct hash_elem *,
+                                    const struct hash_elem *, void *);
+
+/* Returns the shard responsible for `sector`. */
+static inline struct buffer_cache_shard *
+buffer_cache_shard_of (block_sector_t sector)
+{
+  return &shards[(sector >> BUFFER_CACHE_CLUSTER_SHIFT) % BUFFER_CACHE_SHARDS];
+}
 
-/* A global lock for synchronizing buffer cache operations. */
-static struct lock buffer_cache_lock;
+/* Counts a read hit in `shard`, whose lock may be held for reading
+   only: other readers may count hits at the same time, so the
+   (two-word) increment is done with interrupts off. */
+static inline void
+buffer_cache_count_hit (struct buffer_cache_shard *shard)
+{
+  enum intr_level old_level = intr_disable ();
+  shard->hit_cnt ++;
+  intr_set_level (old_level);
+}
 
 void
 buffer_cache_init (void)
 {
-  lock_init (&buffer_cache_lock);
-
-  // initialize entries
-  size_t i;
-  for (i = 0; i < BUFFER_CACHE_SIZE; ++ i)
+  size_t s, i;
+  for (s = 0; s < BUFFER_CACHE_SHARDS; ++ s)
   {
-    cache[i].occupied = false;
+    struct buffer_cache_shard *shard = &shards[s];
+    rwlock_init (&shard->lock);
+    hash_init (&shard->index, buffer_cache_hash_func, buffer_cache_less_func, NULL);
+    shard->clock = 0;
+    cond_init (&shard->io_done);
+    shard->hit_cnt = shard->miss_cnt = shard->readahead_cnt = 0;
+    shard->evict_write_cnt = shard->writebehind_cnt = 0;
+
+    // initialize entries
+    for (i = 0; i < BUFFER_CACHE_SHARD_SIZE; ++ i)
+    {
+      shard->entries[i].occupied = false;
+    }
+  }
+
+  // start the read-ahead daemon
+  lock_init (&readahead_lock);
+  cond_init (&readahead_cond);
+  readahead_head = readahead_size = 0;
+  readahead_running = false;
+  if (buffer_cache_readahead_window > 0) {
+    readahead_running = true;
+    thread_create ("readahead", PRI_DEFAULT, buffer_cache_readahead_daemon, NULL);
+  }
+
+  // start the write-behind daemon
+  lock_init (&writeback_lock);
+  writebehind_running = false;
+  if (buffer_cache_writebehind_interval > 0) {
+    writebehind_buffer = palloc_get_multiple (PAL_ASSERT, WRITEBEHIND_PAGES);
+    writebehind_running = true;
+    thread_create ("writebehind", PRI_DEFAULT, buffer_cache_writebehind_daemon, NULL);
   }
 }
 
 /**
  * An internal method for flushing back the cache entry into disk.
- * Must be called with the lock held.
+ * Must be called with the shard lock held.
  */
 static void
-buffer_cache_flush (struct buffer_cache_entry_t *entry)
+buffer_cache_flush (struct buffer_cache_shard *shard,
+                    struct buffer_cache_entry_t *entry)
 {
-  ASSERT (lock_held_by_current_thread(&buffer_cache_lock));
+  ASSERT (rwlock_held_by_current_thread(&shard->lock));
   ASSERT (entry != NULL && entry->occupied == true);
 
   if (entry->dirty) {
@@ -54,126 +203,719 @@ buffer_cache_flush (struct buffer_cache_entry_t *entry)
 void
 buffer_cache_close (void)
 {
-  // flush buffer cache entries
-  lock_acquire (&buffer_cache_lock);
+  // no more read-ahead from now on
+  lock_acquire (&readahead_lock);
+  readahead_running = false;
+  readahead_size = 0;
+  lock_release (&readahead_lock);
 
-  size_t i;
-  for (i = 0; i < BUFFER_CACHE_SIZE; ++ i)
+  // wait for an ongoing write-behind pass, and stop the daemon
+  lock_acquire (&writeback_lock);
+  writebehind_running = false;
+
+  // flush buffer cache entries
+  size_t s, i;
+  for (s = 0; s < BUFFER_CACHE_SHARDS; ++ s)
   {
-    if (cache[i].occupied == false) continue;
-    buffer_cache_flush( &(cache[i]) );
+    struct buffer_cache_shard *shard = &shards[s];
+    rwlock_acquire_write (&shard->lock);
+
+    for (i = 0; i < BUFFER_CACHE_SHARD_SIZE; ++ i)
+    {
+      if (shard->entries[i].occupied == false) continue;
+      buffer_cache_flush (shard, &(shard->entries[i]));
+    }
+
+    rwlock_release_write (&shard->lock);
   }
 
-  lock_release (&buffer_cache_lock);
+  lock_release (&writeback_lock);
 }
 
 
 /**
  * Lookup the cache entry, and returns the pointer of buffer_cache_entry_t,
- * or NULL in case of cache miss. (simply traverse the cache entries)
+ * or NULL in case of cache miss. (a single hash probe in the shard index)
+ * Must be called with the shard lock held, for reading at least.
  */
 static struct buffer_cache_entry_t*
-buffer_cache_lookup (block_sector_t sector)
+buffer_cache_lookup (struct buffer_cache_shard *shard, block_sector_t sector)
 {
-  size_t i;
-  for (i = 0; i < BUFFER_CACHE_SIZE; ++ i)
-  {
-    if (cache[i].occupied == false) continue;
-    if (cache[i].disk_sector == sector) {
-      // cache hit.
-      return &(cache[i]);
-    }
-  }
-  return NULL; // cache miss
+  ASSERT (rwlock_held (&shard->lock));
+
+  struct buffer_cache_entry_t key;
+  key.disk_sector = sector;
+
+  struct hash_elem *e = hash_find (&shard->index, &key.helem);
+  if (e == NULL) return NULL; // cache miss
+
+  // cache hit.
+  return hash_entry (e, struct buffer_cache_entry_t, helem);
 }
 
 /**
- * Obtain a free cache entry slot.
+ * Obtain a free cache entry slot in the shard.
  * If there is an unoccupied slot already, return it.
  * Otherwise, some entry should be evicted by the clock algorithm.
+ * Entries being written back by the write-behind daemon or pinned
+ * are skipped; if every entry is such, returns NULL -- after waiting
+ * for one of them to become idle if `wait` is true, in which case the
+ * shard lock has been released meanwhile (the caller should look up
+ * the sector again).
  */
 static struct buffer_cache_entry_t*
-buffer_cache_evict (void)
+buffer_cache_evict (struct buffer_cache_shard *shard, bool wait)
 {
-  ASSERT (lock_held_by_current_thread(&buffer_cache_lock));
+  ASSERT (rwlock_held_by_current_thread(&shard->lock));
 
   // clock algorithm
-  static size_t clock = 0;
+  struct buffer_cache_entry_t *slot;
+  size_t busy_cnt = 0;
   while (true) {
-    if (cache[clock].occupied == false) {
+    slot = &shard->entries[shard->clock];
+    if (slot->occupied == false) {
       // found an empty slot -- use it
-      return &(cache[clock]);
+      return slot;
     }
 
-    if (cache[clock].access) {
+    if (slot->busy || slot->pin_cnt > 0) {
+      // in the middle of a write-behind or pinned, can't be evicted
+      if (++ busy_cnt >= BUFFER_CACHE_SHARD_SIZE) {
+        if (wait)
+          rwlock_cond_wait (&shard->io_done, &shard->lock);
+        return NULL;
+      }
+    }
+    else if (slot->access) {
       // give a second chance
-      cache[clock].access = false;
+      busy_cnt = 0;
+      slot->access = false;
     }
     else break;
 
-    clock ++;
-    clock %= BUFFER_CACHE_SIZE;
+    shard->clock ++;
+    shard->clock %= BUFFER_CACHE_SHARD_SIZE;
   }
 
-  // evict cache[clock]
-  struct buffer_cache_entry_t *slot = &cache[clock];
+  // evict the slot under the clock hand
   if (slot->dirty) {
     // write back into disk
-    buffer_cache_flush (slot);
+    shard->evict_write_cnt ++;
+    buffer_cache_flush (shard, slot);
   }
 
+  hash_delete (&shard->index, &slot->helem);
   slot->occupied = false;
   return slot;
 }
 
+/**
+ * Obtain a slot for a prefetched sector, without disturbing the
+ * clock: only an unoccupied slot, or a clean one that has not been
+ * referenced since the clock hand last passed it, is taken.
+ * Returns NULL if there is no such cold slot -- read-ahead never
+ * pays for a write back or pushes out a recently used sector.
+ */
+static struct buffer_cache_entry_t*
+buffer_cache_evict_cold (struct buffer_cache_shard *shard)
+{
+  ASSERT (rwlock_held_by_current_thread(&shard->lock));
 
-void
-buffer_cache_read (block_sector_t sector, void *target)
+  struct buffer_cache_entry_t *victim = NULL;
+  size_t i;
+  for (i = 0; i < BUFFER_CACHE_SHARD_SIZE; ++ i)
+  {
+    struct buffer_cache_entry_t *slot =
+      &shard->entries[(shard->clock + i) % BUFFER_CACHE_SHARD_SIZE];
+    if (slot->occupied == false)
+      return slot;
+    if (victim == NULL && !slot->access && !slot->dirty && !slot->busy
+        && slot->pin_cnt == 0)
+      victim = slot;
+  }
+
+  if (victim != NULL) {
+    hash_delete (&shard->index, &victim->helem);
+    victim->occupied = false;
+  }
+  return victim;
+}
+
+/**
+ * Returns the entry caching `sector`. In case of a cache miss, the
+ * sector is loaded from the disk if `load` is true; otherwise the
+ * caller is about to overwrite the whole sector, and must do so
+ * before releasing the shard lock. If the sector is pinned for
+ * writing, waits for that pin to go away first.
+ * Must be called with the shard lock held.
+ */
+static struct buffer_cache_entry_t*
+buffer_cache_fetch (struct buffer_cache_shard *shard, block_sector_t sector,
+                    bool load)
 {
-  lock_acquire (&buffer_cache_lock);
+  struct buffer_cache_entry_t *slot;
+  while (true) {
+    slot = buffer_cache_lookup (shard, sector);
+    if (slot != NULL && slot->writing) {
+      // modified in place right now: look it up again afterwards
+      rwlock_cond_wait (&shard->io_done, &shard->lock);
+      continue;
+    }
+    if (slot != NULL) {
+      shard->hit_cnt ++;
+      return slot;
+    }
 
-  struct buffer_cache_entry_t *slot = buffer_cache_lookup (sector);
-  if (slot == NULL) {
     // cache miss: need eviction.
-    slot = buffer_cache_evict ();
-    ASSERT (slot != NULL && slot->occupied == false);
-
-    // fill in the cache entry.
-    slot->occupied = true;
-    slot->disk_sector = sector;
-    slot->dirty = false;
+    slot = buffer_cache_evict (shard, true);
+    if (slot != NULL) break;
+  }
+  shard->miss_cnt ++;
+  ASSERT (slot->occupied == false);
+
+  // fill in the cache entry.
+  slot->occupied = true;
+  slot->disk_sector = sector;
+  slot->dirty = false;
+  slot->busy = false;
+  slot->pin_cnt = 0;
+  slot->writing = false;
+  if (load)
     block_read (fs_device, sector, slot->buffer);
+  hash_insert (&shard->index, &slot->helem);
+  return slot;
+}
+
+
+void
+buffer_cache_read (block_sector_t sector, void *target)
+{
+  struct buffer_cache_shard *shard = buffer_cache_shard_of (sector);
+
+  // a hit only needs the shard lock for reading, unless the sector is
+  // being modified in place (then buffer_cache_fetch() waits for it)
+  rwlock_acquire_read (&shard->lock);
+  struct buffer_cache_entry_t *slot = buffer_cache_lookup (shard, sector);
+  if (slot != NULL && !slot->writing) {
+    buffer_cache_count_hit (shard);
+    slot->access = true;
+    memcpy (target, slot->buffer, BLOCK_SECTOR_SIZE);
+    rwlock_release_read (&shard->lock);
+    return;
   }
+  rwlock_release_read (&shard->lock);
+
+  rwlock_acquire_write (&shard->lock);
+  slot = buffer_cache_fetch (shard, sector, true);
 
   // copy the buffer data into memory.
   slot->access = true;
   memcpy (target, slot->buffer, BLOCK_SECTOR_SIZE);
 
-  lock_release (&buffer_cache_lock);
+  rwlock_release_write (&shard->lock);
 }
 
 void
 buffer_cache_write (block_sector_t sector, const void *source)
 {
-  lock_acquire (&buffer_cache_lock);
-
-  struct buffer_cache_entry_t *slot = buffer_cache_lookup (sector);
-  if (slot == NULL) {
-    // cache miss: need eviction.
-    slot = buffer_cache_evict ();
-    ASSERT (slot != NULL && slot->occupied == false);
+  struct buffer_cache_shard *shard = buffer_cache_shard_of (sector);
+  rwlock_acquire_write (&shard->lock);
 
-    // fill in the cache entry.
-    slot->occupied = true;
-    slot->disk_sector = sector;
-    slot->dirty = false;
-    block_read (fs_device, sector, slot->buffer);
-  }
+  // the whole sector is overwritten: no need to read it on a miss
+  struct buffer_cache_entry_t *slot = buffer_cache_fetch (shard, sector, false);
 
   // copy the data form memory into the buffer cache.
   slot->access = true;
   slot->dirty = true;
   memcpy (slot->buffer, source, BLOCK_SECTOR_SIZE);
 
-  lock_release (&buffer_cache_lock);
+  rwlock_release_write (&shard->lock);
+}
+
+/* Returns the number of sectors from `sector` up to the end of its
+   cluster, i.e. that are in the same shard. */
+static inline size_t
+buffer_cache_cluster_left (block_sector_t sector)
+{
+  size_t cluster_size = 1 << BUFFER_CACHE_CLUSTER_SHIFT;
+  return cluster_size - (sector & (cluster_size - 1));
+}
+
+void
+buffer_cache_read_multiple (block_sector_t sector, size_t cnt, void *target_)
+{
+  uint8_t *target = target_;
+
+  // a cluster fits in the bounce buffer
+  ASSERT ((BLOCK_SECTOR_SIZE << BUFFER_CACHE_CLUSTER_SHIFT) <= PGSIZE);
+
+  while (cnt > 0) {
+    // the rest of the cluster is served under the shard lock, held
+    // for reading as long as the sectors are cached
+    struct buffer_cache_shard *shard = buffer_cache_shard_of (sector);
+    size_t n = buffer_cache_cluster_left (sector);
+    if (n > cnt) n = cnt;
+
+    // a run of hits only needs the shard lock for reading; a sector
+    // being modified in place ends it, like a miss
+    size_t i = 0, j;
+    struct buffer_cache_entry_t *slot;
+    rwlock_acquire_read (&shard->lock);
+    while (i < n && (slot = buffer_cache_lookup (shard, sector + i)) != NULL
+           && !slot->writing) {
+      buffer_cache_count_hit (shard);
+      slot->access = true;
+      memcpy (target + i * BLOCK_SECTOR_SIZE, slot->buffer, BLOCK_SECTOR_SIZE);
+      i ++;
+    }
+    rwlock_release_read (&shard->lock);
+    if (i == n) {
+      sector += n;
+      target += n * BLOCK_SECTOR_SIZE;
+      cnt -= n;
+      continue;
+    }
+
+    // the rest goes through a kernel bounce buffer: the disk is
+    // read by the device's I/O thread, which cannot reach the
+    // caller's (user) buffer, and nothing may fault on the caller's
+    // buffer while the shard is locked for writing
+    uint8_t *bounce = palloc_get_page (0);
+    if (bounce == NULL) {
+      // no memory to spare: one sector at a time, through the cache
+      for (; i < n; ++ i) {
+        struct buffer_cache_entry_t *entry = buffer_cache_pin (sector + i);
+        memcpy (target + i * BLOCK_SECTOR_SIZE, buffer_cache_borrow (entry),
+                BLOCK_SECTOR_SIZE);
+        buffer_cache_unpin (entry);
+      }
+    }
+    else {
+      size_t first = i;
+
+      rwlock_acquire_write (&shard->lock);
+      while (i < n) {
+        slot = buffer_cache_lookup (shard, sector + i);
+        if (slot != NULL && slot->writing) {
+          rwlock_cond_wait (&shard->io_done, &shard->lock);
+          continue;
+        }
+        if (slot != NULL) {
+          // cache hit
+          shard->hit_cnt ++;
+          slot->access = true;
+          memcpy (bounce + i * BLOCK_SECTOR_SIZE, slot->buffer, BLOCK_SECTOR_SIZE);
+          i ++;
+          continue;
+        }
+
+        // a run of misses: read it with a single request, then keep
+        // a copy of each sector in the cache
+        size_t m = 1;
+        while (i + m < n && buffer_cache_lookup (shard, sector + i + m) == NULL)
+          m ++;
+        block_read_multiple (fs_device, sector + i, m, bounce + i * BLOCK_SECTOR_SIZE);
+        shard->miss_cnt += m;
+
+        for (j = i; j < i + m; ++ j) {
+          // the lock is kept, so that nobody caches these sectors meanwhile
+          slot = buffer_cache_evict (shard, false);
+          if (slot == NULL) break;
+          slot->occupied = true;
+          slot->disk_sector = sector + j;
+          slot->dirty = false;
+          slot->access = true;
+          slot->busy = false;
+          slot->pin_cnt = 0;
+          slot->writing = false;
+          memcpy (slot->buffer, bounce + j * BLOCK_SECTOR_SIZE, BLOCK_SECTOR_SIZE);
+          hash_insert (&shard->index, &slot->helem);
+        }
+        i += m;
+      }
+      rwlock_release_write (&shard->lock);
+
+      memcpy (target + first * BLOCK_SECTOR_SIZE, bounce + first * BLOCK_SECTOR_SIZE,
+              (n - first) * BLOCK_SECTOR_SIZE);
+      palloc_free_page (bounce);
+    }
+
+    sector += n;
+    target += n * BLOCK_SECTOR_SIZE;
+    cnt -= n;
+  }
+}
+
+void
+buffer_cache_write_multiple (block_sector_t sector, size_t cnt, const void *source_)
+{
+  const uint8_t *source = source_;
+
+  while (cnt > 0) {
+    // the rest of the cluster is served under a single lock
+    struct buffer_cache_shard *shard = buffer_cache_shard_of (sector);
+    size_t n = buffer_cache_cluster_left (sector);
+    if (n > cnt) n = cnt;
+
+    rwlock_acquire_write (&shard->lock);
+    size_t i;
+    for (i = 0; i < n; ++ i) {
+      struct buffer_cache_entry_t *slot =
+        buffer_cache_fetch (shard, sector + i, false);
+      slot->access = true;
+      slot->dirty = true;
+      memcpy (slot->buffer, source + i * BLOCK_SECTOR_SIZE, BLOCK_SECTOR_SIZE);
+    }
+    rwlock_release_write (&shard->lock);
+
+    sector += n;
+    source += n * BLOCK_SECTOR_SIZE;
+    cnt -= n;
+  }
+}
+
+struct buffer_cache_entry_t *
+buffer_cache_pin (block_sector_t sector)
+{
+  struct buffer_cache_shard *shard = buffer_cache_shard_of (sector);
+  rwlock_acquire_write (&shard->lock);
+
+  struct buffer_cache_entry_t *slot = buffer_cache_fetch (shard, sector, true);
+  slot->access = true;
+  slot->pin_cnt ++;
+
+  rwlock_release_write (&shard->lock);
+  return slot;
+}
+
+struct buffer_cache_entry_t *
+buffer_cache_pin_mut (block_sector_t sector)
+{
+  struct buffer_cache_shard *shard = buffer_cache_shard_of (sector);
+  rwlock_acquire_write (&shard->lock);
+
+  // wait for the other pins to go away (the entry may be evicted
+  // meanwhile, so fetch it again after each wait)
+  struct buffer_cache_entry_t *slot;
+  while ((slot = buffer_cache_fetch (shard, sector, true))->pin_cnt > 0)
+    rwlock_cond_wait (&shard->io_done, &shard->lock);
+  slot->access = true;
+  slot->pin_cnt = 1;
+  slot->writing = true;
+
+  rwlock_release_write (&shard->lock);
+  return slot;
+}
+
+const void *
+buffer_cache_borrow (struct buffer_cache_entry_t *entry)
+{
+  ASSERT (entry->pin_cnt > 0);
+  return entry->buffer;
+}
+
+void *
+buffer_cache_borrow_mut (struct buffer_cache_entry_t *entry)
+{
+  buffer_cache_mark_dirty (entry);
+  return entry->buffer;
+}
+
+void
+buffer_cache_mark_dirty (struct buffer_cache_entry_t *entry)
+{
+  struct buffer_cache_shard *shard = buffer_cache_shard_of (entry->disk_sector);
+  ASSERT (entry->pin_cnt > 0 && entry->writing);
+
+  rwlock_acquire_write (&shard->lock);
+  entry->dirty = true;
+  rwlock_release_write (&shard->lock);
+}
+
+void
+buffer_cache_unpin (struct buffer_cache_entry_t *entry)
+{
+  struct buffer_cache_shard *shard = buffer_cache_shard_of (entry->disk_sector);
+  rwlock_acquire_write (&shard->lock);
+
+  ASSERT (entry->pin_cnt > 0);
+  if (-- entry->pin_cnt == 0) {
+    entry->writing = false;
+    rwlock_cond_broadcast (&shard->io_done, &shard->lock);
+  }
+
+  rwlock_release_write (&shard->lock);
+}
+
+void
+buffer_cache_readahead (block_sector_t sector)
+{
+  lock_acquire (&readahead_lock);
+  if (readahead_running && readahead_size < READAHEAD_QUEUE_SIZE) {
+    size_t tail = (readahead_head + readahead_size) % READAHEAD_QUEUE_SIZE;
+    readahead_queue[tail] = sector;
+    readahead_size ++;
+    cond_signal (&readahead_cond, &readahead_lock);
+  }
+  lock_release (&readahead_lock);
+}
+
+/**
+ * Bring `sector` into the cache, if it is not cached yet and a
+ * cold slot is available. The entry is left unreferenced, so that
+ * a prefetched sector nobody reads is the first to go.
+ */
+static void
+buffer_cache_prefetch (block_sector_t sector)
+{
+  struct buffer_cache_shard *shard = buffer_cache_shard_of (sector);
+  rwlock_acquire_write (&shard->lock);
+
+  if (buffer_cache_lookup (shard, sector) == NULL) {
+    struct buffer_cache_entry_t *slot = buffer_cache_evict_cold (shard);
+    if (slot != NULL) {
+      slot->occupied = true;
+      slot->disk_sector = sector;
+      slot->dirty = false;
+      slot->access = false;
+      slot->busy = false;
+      slot->pin_cnt = 0;
+      slot->writing = false;
+      block_read (fs_device, sector, slot->buffer);
+      hash_insert (&shard->index, &slot->helem);
+      shard->readahead_cnt ++;
+    }
+  }
+
+  rwlock_release_write (&shard->lock);
+}
+
+/* The read-ahead daemon: fetches queued sectors, one at a time. */
+static void
+buffer_cache_readahead_daemon (void *aux UNUSED)
+{
+  while (true) {
+    lock_acquire (&readahead_lock);
+    while (readahead_size == 0)
+      cond_wait (&readahead_cond, &readahead_lock);
+
+    block_sector_t sector = readahead_queue[readahead_head];
+    readahead_head = (readahead_head + 1) % READAHEAD_QUEUE_SIZE;
+    readahead_size --;
+    lock_release (&readahead_lock);
+
+    buffer_cache_prefetch (sector);
+  }
+}
+
+/* Orders write-behind items by ascending sector number. */
+static int
+writebehind_item_compare (const void *a_, const void *b_)
+{
+  const struct writebehind_item *a = a_;
+  const struct writebehind_item *b = b_;
+  return a->sector < b->sector ? -1 : a->sector > b->sector;
+}
+
+/**
+ * Write back every dirty entry of the cache, in one sweep of
+ * ascending sector numbers. The dirty sectors are copied out and
+ * marked clean and busy under the shard locks; the disk writes are
+ * done with no shard lock held. A sector written again meanwhile
+ * is simply dirty again, and will be picked up by the next pass.
+ * Must be called with writeback_lock held.
+ */
+static void
+buffer_cache_writebehind (void)
+{
+  ASSERT (lock_held_by_current_thread(&writeback_lock));
+
+  size_t cnt = 0, s, i;
+  for (s = 0; s < BUFFER_CACHE_SHARDS; ++ s)
+  {
+    struct buffer_cache_shard *shard = &shards[s];
+    rwlock_acquire_write (&shard->lock);
+    for (i = 0; i < BUFFER_CACHE_SHARD_SIZE; ++ i)
+    {
+      struct buffer_cache_entry_t *entry = &shard->entries[i];
+      if (!entry->occupied || !entry->dirty) continue;
+      if (entry->pin_cnt > 0) continue;   // may be half-modified; next time
+
+      struct writebehind_item *item = &writebehind_batch[cnt];
+      item->sector = entry->disk_sector;
+      item->data = writebehind_buffer + cnt * BLOCK_SECTOR_SIZE;
+      memcpy (item->data, entry->buffer, BLOCK_SECTOR_SIZE);
+      entry->dirty = false;
+      entry->busy = true;
+      cnt ++;
+    }
+    rwlock_release_write (&shard->lock);
+  }
+  if (cnt == 0) return;
+
+  // write back, in sector order
+  qsort (writebehind_batch, cnt, sizeof *writebehind_batch,
+         writebehind_item_compare);
+  for (i = 0; i < cnt; ++ i)
+    block_write (fs_device, writebehind_batch[i].sector, writebehind_batch[i].data);
+
+  // done; the entries may be evicted again
+  for (s = 0; s < BUFFER_CACHE_SHARDS; ++ s)
+  {
+    struct buffer_cache_shard *shard = &shards[s];
+    rwlock_acquire_write (&shard->lock);
+    for (i = 0; i < BUFFER_CACHE_SHARD_SIZE; ++ i)
+    {
+      if (shard->entries[i].busy) {
+        shard->entries[i].busy = false;
+        shard->writebehind_cnt ++;
+      }
+    }
+    rwlock_cond_broadcast (&shard->io_done, &shard->lock);
+    rwlock_release_write (&shard->lock);
+  }
+}
+
+/* The write-behind daemon: writes back dirty entries periodically. */
+static void
+buffer_cache_writebehind_daemon (void *aux UNUSED)
+{
+  while (true) {
+    timer_sleep (buffer_cache_writebehind_interval);
+
+    lock_acquire (&writeback_lock);
+    if (!writebehind_running) {
+      lock_release (&writeback_lock);
+      break;
+    }
+    buffer_cache_writebehind ();
+    lock_release (&writeback_lock);
+  }
+}
+
+/* Prints buffer cache statistics. */
+void
+buffer_cache_print_stats (void)
+{
+  unsigned long long hit_cnt = 0, miss_cnt = 0, readahead_cnt = 0;
+  unsigned long long evict_write_cnt = 0, writebehind_cnt = 0;
+  size_t s;
+  for (s = 0; s < BUFFER_CACHE_SHARDS; ++ s)
+  {
+    hit_cnt += shards[s].hit_cnt;
+    miss_cnt += shards[s].miss_cnt;
+    readahead_cnt += shards[s].readahead_cnt;
+    evict_write_cnt += shards[s].evict_write_cnt;
+    writebehind_cnt += shards[s].writebehind_cnt;
+  }
+  printf ("Buffer cache: %llu hits, %llu misses, %llu read-ahead\n",
+          hit_cnt, miss_cnt, readahead_cnt);
+  printf ("Buffer cache: %llu written back by eviction, %llu by write-behind\n",
+          evict_write_cnt, writebehind_cnt);
+}
+
+/* Benchmark: the sectors read over and over, one cluster per shard,
+   which all fit in the cache together. */
+#define BENCH_SECTORS (BUFFER_CACHE_SHARDS << BUFFER_CACHE_CLUSTER_SHIFT)
+#define BENCH_MAX_READERS 16
+#define BENCH_TICKS 50
+
+static volatile bool bench_stop;
+static long long bench_hits[BENCH_MAX_READERS];
+static struct semaphore bench_done;
+
+/* A benchmark reader: reads cached sectors, each one starting at a
+   different sector, until told to stop. */
+static void
+buffer_cache_bench_reader (void *cnt_)
+{
+  long long *cnt = cnt_;
+  uint8_t data[BLOCK_SECTOR_SIZE];
+  block_sector_t sector = (cnt - bench_hits) * 5;
+
+  while (!bench_stop) {
+    buffer_cache_read (sector % BENCH_SECTORS, data);
+    ++ *cnt;
+    sector ++;
+  }
+  sema_up (&bench_done);
+}
+
+/* Returns the number of misses of all shards. */
+static unsigned long long
+buffer_cache_miss_cnt (void)
+{
+  unsigned long long miss_cnt = 0;
+  size_t s;
+  for (s = 0; s < BUFFER_CACHE_SHARDS; ++ s)
+    miss_cnt += shards[s].miss_cnt;
+  return miss_cnt;
+}
+
+/* Times read hits from 1, 4 and 16 kernel threads reading cached
+   sectors at the same time, and prints the time per hit and hits
+   per second of each, along with the misses meanwhile (none is
+   expected).  The "cachebench" action. */
+void
+buffer_cache_bench (char **argv UNUSED)
+{
+  static const int reader_cnts[] = {1, 4, 16};
+  uint8_t data[BLOCK_SECTOR_SIZE];
+  size_t i;
+  int r;
+
+  // bring the sectors in; the readers run at a lower priority
+  for (i = 0; i < BENCH_SECTORS; ++ i)
+    buffer_cache_read (i, data);
+  sema_init (&bench_done, 0);
+  thread_set_priority (PRI_DEFAULT + 1);
+
+  for (r = 0; r < (int) (sizeof reader_cnts / sizeof *reader_cnts); ++ r) {
+    int reader_cnt = reader_cnts[r], j;
+    unsigned long long misses = buffer_cache_miss_cnt ();
+    long long total = 0;
+
+    bench_stop = false;
+    for (j = 0; j < reader_cnt; ++ j) {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", j);
+      bench_hits[j] = 0;
+      if (thread_create (name, PRI_DEFAULT, buffer_cache_bench_reader,
+                         &bench_hits[j]) == TID_ERROR)
+        PANIC ("cachebench: creating reader %d failed", j);
+    }
+
+    int64_t start = timer_ns ();
+    timer_sleep (BENCH_TICKS);
+    bench_stop = true;
+    int64_t ns = timer_ns () - start;
+    for (j = 0; j < reader_cnt; ++ j)
+      total += bench_hits[j];
+    for (j = 0; j < reader_cnt; ++ j)
+      sema_down (&bench_done);
+
+    printf ("cachebench: %d readers: %lld ns per hit, %lld hits/s, %llu misses\n",
+            reader_cnt, total > 0 ? ns / total : 0,
+            ns > 0 ? total * 1000000000 / ns : 0,
+            buffer_cache_miss_cnt () - misses);
+  }
+  thread_set_priority (PRI_DEFAULT);
+}
+
+
+/* Helpers */
+
+// Hash Functions required for [buffer_cache_shard::index]. Uses 'disk_sector' as key.
+static unsigned
+buffer_cache_hash_func (const struct hash_elem *elem, void *aux UNUSED)
+{
+  struct buffer_cache_entry_t *entry = hash_entry(elem, struct buffer_cache_entry_t, helem);
+  return hash_int ((int) entry->disk_sector);
+}
+static bool
+buffer_cache_less_func (const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED)
+{
+  struct buffer_cache_entry_t *a_entry = hash_entry(a, struct buffer_cache_entry_t, helem);
+  struct buffer_cache_entry_t *b_entry = hash_entry(b, struct buffer_cache_entry_t, helem);
+  return a_entry->disk_sector < b_entry->disk_sector;
 }
@@ -1,10 +1,19 @@
 #ifndef FILESYS_CACHE_H
 #define FILESYS_CACHE_H
 
+#include <stddef.h>
 #include "devices/block.h"
 
 /* Buffer Caches. */
 
+/* Number of sectors prefetched ahead of a sequential reader.
+   Controlled by kernel command-line option "-ra=N". */
+extern size_t buffer_cache_readahead_window;
+
+/* Number of timer ticks between two passes of the write-behind
+   daemon.  Controlled by kernel command-line option "-wb=N". */
+extern unsigned buffer_cache_writebehind_interval;
+
 void buffer_cache_init (void);
 void buffer_cache_close (void);
 
@@ -20,4 +29,54 @@ void buffer_cache_read (block_sector_t sector, void *target);
  */
 void buffer_cache_write (block_sector_t sector, const void *source);
 
+/**
+ * Vectored versions of the above: read or write `cnt` consecutive
+ * sectors starting at `sector`. The shard lock is taken once per
+ * cluster of sectors rather than once per sector, and consecutive
+ * sectors missing in the cache are read with a single multi-sector
+ * request.
+ */
+void buffer_cache_read_multiple (block_sector_t sector, size_t cnt, void *target);
+void buffer_cache_write_multiple (block_sector_t sector, size_t cnt,
+                                  const void *source);
+
+/**
+ * Zero-copy access to cached sectors.
+ *
+ * buffer_cache_pin() brings the disk sector `sector` into the cache
+ * and pins it there: the entry is not evicted, nor written back by
+ * the write-behind daemon, until the matching buffer_cache_unpin().
+ * While pinned, its BLOCK_SECTOR_SIZE bytes can be read in place
+ * through buffer_cache_borrow().
+ *
+ * buffer_cache_pin_mut() pins the sector exclusively, for modifying
+ * it in place through buffer_cache_borrow_mut(), which also marks it
+ * dirty.  It waits for the other pins of the sector to go away, and
+ * until its buffer_cache_unpin(), every other access to the sector
+ * (pins, reads and writes) waits: nobody sees it half-modified.
+ * A thread must not access a sector it has pinned exclusively, other
+ * than through the borrowed buffer, nor pin again a sector it has
+ * pinned.  Pins should be short-lived, and a thread should hold few
+ * at a time.
+ */
+struct buffer_cache_entry_t;
+
+struct buffer_cache_entry_t *buffer_cache_pin (block_sector_t sector);
+struct buffer_cache_entry_t *buffer_cache_pin_mut (block_sector_t sector);
+const void *buffer_cache_borrow (struct buffer_cache_entry_t *);
+void *buffer_cache_borrow_mut (struct buffer_cache_entry_t *);
+void buffer_cache_mark_dirty (struct buffer_cache_entry_t *);
+void buffer_cache_unpin (struct buffer_cache_entry_t *);
+
+/**
+ * Asynchronously prefetch the disk sector `sector` into the cache.
+ * This is a hint only: it never blocks on disk I/O, and may be
+ * dropped if the read-ahead queue is full.
+ */
+void buffer_cache_readahead (block_sector_t sector);
+
+/* Statistics. */
+void buffer_cache_print_stats (void);
+void buffer_cache_bench (char **argv);
+
 #endif
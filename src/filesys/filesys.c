@@ -30,6 +30,14 @@ filesys_init (bool format)
 
   if (format)
     do_format ();
+  else {
+    // new inodes follow the format of the file system
+    struct inode *root = inode_open (ROOT_DIR_SECTOR);
+    if (root == NULL)
+      PANIC ("can't open root directory");
+    inode_format = inode_get_format (root);
+    inode_close (root);
+  }
 
   free_map_open ();
 }
@@ -147,7 +155,8 @@ filesys_chdir (const char *name)
 static void
 do_format (void)
 {
-  printf ("Formatting file system...");
+  printf ("Formatting file system (%s inodes)...",
+          inode_format == INODE_FORMAT_EXTENT ? "extent" : "indirect");
   free_map_create ();
   if (!dir_create (ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
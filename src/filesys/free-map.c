@@ -1,6 +1,7 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <stdio.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
@@ -8,6 +9,15 @@
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
 
+/* Number of free sectors left in front of a run that could not
+   be placed at its goal, for the file ending there to grow into.
+   Keeps files growing in turn from interleaving sector by sector. */
+#define FREE_MAP_SLACK 16
+
+/* Statistics. */
+static unsigned long long alloc_run_cnt;     /* # of runs allocated. */
+static unsigned long long alloc_sector_cnt;  /* # of sectors allocated. */
+
 /* Initializes the free map. */
 void
 free_map_init (void)
@@ -30,23 +40,94 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
   block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
   if (sector != BITMAP_ERROR
       && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+      && !bitmap_write_partial (free_map, free_map_file, sector, cnt))
     {
       bitmap_set_multiple (free_map, sector, cnt, false);
       sector = BITMAP_ERROR;
     }
   if (sector != BITMAP_ERROR)
-    *sectorp = sector;
+    {
+      *sectorp = sector;
+      alloc_run_cnt++;
+      alloc_sector_cnt += cnt;
+    }
   return sector != BITMAP_ERROR;
 }
 
+/* Allocates a run of up to CNT consecutive sectors, as close as
+   possible to sector GOAL: the free sectors starting right at
+   GOAL if there are any, so that the run extends the one ending
+   before GOAL, otherwise the first large enough run at or after
+   GOAL (preceded by FREE_MAP_SLACK free sectors, if possible).
+   If no run of CNT sectors is free, asks for half as many, and
+   so on.
+   Stores the first sector into *SECTORP and the number of sectors
+   allocated, between 1 and CNT, into *CNTP.
+   Returns true if successful, false if the disk is full or if the
+   free_map file could not be written. */
+bool
+free_map_allocate_near (size_t cnt, block_sector_t goal,
+                        block_sector_t *sectorp, size_t *cntp)
+{
+  size_t size = bitmap_size (free_map);
+  size_t sector = BITMAP_ERROR;
+  size_t n = 0;
+
+  ASSERT (cnt > 0);
+  if (goal >= size)
+    goal = 0;
+
+  /* Free sectors right at GOAL. */
+  while (n < cnt && goal + n < size && !bitmap_test (free_map, goal + n))
+    n++;
+  if (n > 0)
+    sector = goal;
+
+  /* First fit at or after GOAL, leaving some slack in front. */
+  if (sector == BITMAP_ERROR)
+    {
+      sector = bitmap_scan (free_map, goal, cnt + FREE_MAP_SLACK, false);
+      if (sector != BITMAP_ERROR)
+        {
+          sector += FREE_MAP_SLACK;
+          n = cnt;
+        }
+    }
+
+  /* First fit at or after GOAL, then from the beginning. */
+  for (n = n > 0 ? n : cnt; sector == BITMAP_ERROR && n > 0; n /= 2)
+    {
+      sector = bitmap_scan (free_map, goal, n, false);
+      if (sector == BITMAP_ERROR && goal > 0)
+        sector = bitmap_scan (free_map, 0, n, false);
+      if (sector != BITMAP_ERROR)
+        break;
+    }
+  if (sector == BITMAP_ERROR)
+    return false;
+
+  bitmap_set_multiple (free_map, sector, n, true);
+  if (free_map_file != NULL
+      && !bitmap_write_partial (free_map, free_map_file, sector, n))
+    {
+      bitmap_set_multiple (free_map, sector, n, false);
+      return false;
+    }
+
+  *sectorp = sector;
+  *cntp = n;
+  alloc_run_cnt++;
+  alloc_sector_cnt += n;
+  return true;
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
   ASSERT (bitmap_all (free_map, sector, cnt));
   bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  bitmap_write_partial (free_map, free_map_file, sector, cnt);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -83,3 +164,11 @@ free_map_create (void)
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
 }
+
+/* Prints free map statistics. */
+void
+free_map_print_stats (void)
+{
+  printf ("Free map: %llu sectors allocated in %llu runs\n",
+          alloc_sector_cnt, alloc_run_cnt);
+}
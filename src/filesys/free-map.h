@@ -12,6 +12,10 @@ void free_map_open (void);
 void free_map_close (void);
 
 bool free_map_allocate (size_t, block_sector_t *);
+bool free_map_allocate_near (size_t, block_sector_t goal,
+                             block_sector_t *, size_t *);
 void free_map_release (block_sector_t, size_t);
 
+void free_map_print_stats (void);
+
 #endif /* filesys/free-map.h */
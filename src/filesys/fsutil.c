@@ -7,6 +7,8 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "devices/ide.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -221,3 +223,62 @@ fsutil_append (char **argv)
   file_close (src);
   free (buffer);
 }
+
+/* Reads all of block device ARGV[1] in 64-sector requests in each
+   IDE transfer mode, printing the throughput of each.  Scratch
+   devices are also written back with the data just read; others
+   are only read, so that the file system's cache stays valid. */
+void
+fsutil_blockbench (char **argv)
+{
+  static const char *mode_names[] = {"PIO", "multi-sector PIO", "DMA"};
+  const char *bdev_name = argv[1];
+  const size_t request_sectors = 64;
+  struct block *block;
+  block_sector_t size;
+  bool write;
+  void *buffer;
+  int mode;
+
+  block = block_get_by_name (bdev_name);
+  if (block == NULL)
+    PANIC ("%s: no such block device", bdev_name);
+  size = block_size (block);
+  write = block_type (block) == BLOCK_SCRATCH;
+  buffer = palloc_get_multiple (PAL_ASSERT,
+                                request_sectors * BLOCK_SECTOR_SIZE / PGSIZE);
+
+  for (mode = IDE_XFER_PIO; mode <= IDE_XFER_DMA; mode++)
+    {
+      block_sector_t sector;
+      int64_t start, ticks;
+
+      if (!ide_set_xfer_mode (mode))
+        {
+          printf ("%s: %s: not supported\n", bdev_name, mode_names[mode]);
+          continue;
+        }
+
+      start = timer_ticks ();
+      for (sector = 0; sector < size; sector += request_sectors)
+        {
+          size_t cnt = size - sector < request_sectors
+                       ? size - sector : request_sectors;
+          block_read_multiple (block, sector, cnt, buffer);
+          if (write)
+            block_write_multiple (block, sector, cnt, buffer);
+        }
+      ticks = timer_elapsed (start);
+
+      printf ("%s: %s: %"PRDSNu" sectors %s in %"PRId64" ticks",
+              bdev_name, mode_names[mode], size,
+              write ? "read and written" : "read", ticks);
+      if (ticks > 0)
+        printf (" (%"PRId64" sectors/s)",
+                (int64_t) size * (write ? 2 : 1) * TIMER_FREQ / ticks);
+      printf ("\n");
+    }
+
+  ide_set_xfer_mode (IDE_XFER_DMA);
+  palloc_free_multiple (buffer, request_sectors * BLOCK_SECTOR_SIZE / PGSIZE);
+}
@@ -2,11 +2,14 @@
 #include <list.h>
 #include <debug.h>
 #include <round.h>
+#include <stdio.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "filesys/cache.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -14,16 +17,38 @@
 #define DIRECT_BLOCKS_COUNT 123
 #define INDIRECT_BLOCKS_PER_SECTOR 128
 
+#define INODE_EXTENTS_COUNT 60
+#define EXTENTS_PER_BLOCK 63
+
+/* A run of consecutive data sectors. */
+struct inode_extent
+  {
+    block_sector_t start;               /* First sector of the run. */
+    uint32_t length;                    /* Number of sectors in the run. */
+  };
+
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 struct inode_disk
   {
-    /** Data sectors */
-    block_sector_t direct_blocks[DIRECT_BLOCKS_COUNT];
-    block_sector_t indirect_block;
-    block_sector_t doubly_indirect_block;
+    /** Data sectors, depending on the format (see `version`) */
+    union {
+      struct {    // INODE_FORMAT_INDIRECT
+        block_sector_t direct_blocks[DIRECT_BLOCKS_COUNT];
+        block_sector_t indirect_block;
+        block_sector_t doubly_indirect_block;
+      };
+      struct {    // INODE_FORMAT_EXTENT
+        uint32_t sector_cnt;            /* Number of sectors allocated. */
+        uint32_t extent_cnt;            /* Number of used `extents'. */
+        block_sector_t extent_block;    /* First overflow extent block, or 0. */
+        block_sector_t extent_tail;     /* Last overflow extent block, or 0. */
+        struct inode_extent extents[INODE_EXTENTS_COUNT];
+      };
+    };
 
     bool is_dir;
+    uint8_t version;                    /* enum inode_format. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
   };
@@ -32,8 +57,20 @@ struct inode_indirect_block_sector {
   block_sector_t blocks[INDIRECT_BLOCKS_PER_SECTOR];
 };
 
-static bool inode_allocate (struct inode_disk *disk_inode);
-static bool inode_reserve (struct inode_disk *disk_inode, off_t length);
+/* Extents that don't fit in the on-disk inode are kept in a
+   chain of extent blocks. */
+struct inode_extent_block_sector {
+  uint32_t extent_cnt;                  /* Number of used `extents'. */
+  block_sector_t next;                  /* Next extent block, or 0. */
+  struct inode_extent extents[EXTENTS_PER_BLOCK];
+};
+
+/* Format of the inodes created from now on. */
+enum inode_format inode_format = INODE_FORMAT_EXTENT;
+
+static bool inode_allocate (block_sector_t sector, struct inode_disk *disk_inode);
+static bool inode_reserve (block_sector_t sector, struct inode_disk *disk_inode,
+                           off_t length);
 static bool inode_deallocate (struct inode *inode);
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -50,6 +87,15 @@ min (size_t a, size_t b)
   return a < b ? a : b;
 }
 
+/* A run of consecutive sectors of a file: sector indices
+   [index, index + length) are stored at [sector, sector + length). */
+struct inode_run
+  {
+    off_t index;
+    off_t length;
+    block_sector_t sector;
+  };
+
 /* In-memory inode. */
 struct inode
   {
@@ -59,84 +105,271 @@ struct inode
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
     struct inode_disk data;             /* Inode content. */
+
+    off_t readahead_next;               /* Sector index a sequential reader reads next. */
+    off_t readahead_end;                /* Sector index up to which read-ahead is queued. */
+
+    /* Block-map cache: the run of the last translated sector, and
+       the last indirect block used, identified by map_indirect_key
+       (-1: none, 0: the indirect block, 1 + i: the i-th block of the
+       doubly indirect block). Invalidated whenever the block map
+       changes. Page-out, page faults and the read-ahead daemon look
+       sectors up outside filesys_lock, so map_lock protects these
+       and the block map in `data' itself. */
+    struct lock map_lock;
+    struct inode_run map_run;
+    off_t map_indirect_key;
+    struct inode_indirect_block_sector map_indirect;
   };
 
+/* Statistics of the block-map translation. */
+static unsigned long long map_lookup_cnt;     /* # of sector lookups. */
+static unsigned long long map_hit_cnt;        /* # served by the run cache. */
+static unsigned long long map_meta_read_cnt;  /* # of block-map sectors read. */
+
+/* Returns the INDEXth entry of the indirect block at SECTOR,
+   looked up in place in the buffer cache. */
 static block_sector_t
-index_to_sector (const struct inode_disk *idisk, off_t index)
+indirect_block_entry (block_sector_t sector, off_t index)
+{
+  struct buffer_cache_entry_t *entry = buffer_cache_pin (sector);
+  const struct inode_indirect_block_sector *indirect_idisk =
+    buffer_cache_borrow (entry);
+  block_sector_t ret = indirect_idisk->blocks[index];
+  buffer_cache_unpin (entry);
+  map_meta_read_cnt ++;
+  return ret;
+}
+
+/* Returns the indirect block identified by KEY (see
+   inode::map_indirect_key), stored at SECTOR, through the inode's
+   indirect block cache. SECTOR is only used on a cache miss. */
+static const struct inode_indirect_block_sector *
+inode_indirect_block (struct inode *inode, off_t key, block_sector_t sector)
+{
+  if (inode->map_indirect_key != key) {
+    buffer_cache_read (sector, &inode->map_indirect);
+    inode->map_indirect_key = key;
+    map_meta_read_cnt ++;
+  }
+  return &inode->map_indirect;
+}
+
+/* Returns the number of consecutive sectors starting at BLOCKS[I],
+   among the first CNT entries of BLOCKS. */
+static off_t
+blocks_run_length (const block_sector_t *blocks, size_t i, size_t cnt)
+{
+  size_t n = 1;
+  while (i + n < cnt && blocks[i + n] == blocks[i] + n)
+    n ++;
+  return n;
+}
+
+/* Finds the run of consecutive sectors containing sector index
+   INDEX of an INODE_FORMAT_INDIRECT inode. */
+static bool
+indirect_index_to_run (struct inode *inode, off_t index, struct inode_run *run)
 {
+  const struct inode_disk *idisk = &inode->data;
   off_t index_base = 0, index_limit = 0;   // base, limit for sector index
-  block_sector_t ret;
+  off_t num_sectors = bytes_to_sectors (idisk->length);
+  const block_sector_t *blocks;
+  size_t i, cnt;
+
+  if (index >= num_sectors)
+    return false;
 
   // (1) direct blocks
   index_limit += DIRECT_BLOCKS_COUNT * 1;
   if (index < index_limit) {
-    return idisk->direct_blocks[index];
+    blocks = idisk->direct_blocks;
+    goto found;
   }
   index_base = index_limit;
 
   // (2) a single indirect block
   index_limit += 1 * INDIRECT_BLOCKS_PER_SECTOR;
   if (index < index_limit) {
-    struct inode_indirect_block_sector *indirect_idisk;
-    indirect_idisk = calloc(1, sizeof(struct inode_indirect_block_sector));
-    buffer_cache_read (idisk->indirect_block, indirect_idisk);
-
-    ret = indirect_idisk->blocks[ index - index_base ];
-    free(indirect_idisk);
-
-    return ret;
+    blocks = inode_indirect_block (inode, 0, idisk->indirect_block)->blocks;
+    goto found;
   }
   index_base = index_limit;
 
   // (3) a single doubly indirect block
   index_limit += 1 * INDIRECT_BLOCKS_PER_SECTOR * INDIRECT_BLOCKS_PER_SECTOR;
   if (index < index_limit) {
-    // first and second level block index, respecitvely
-    off_t index_first =  (index - index_base) / INDIRECT_BLOCKS_PER_SECTOR;
-    off_t index_second = (index - index_base) % INDIRECT_BLOCKS_PER_SECTOR;
+    // first level block index; the second level block is cached
+    off_t index_first = (index - index_base) / INDIRECT_BLOCKS_PER_SECTOR;
+    off_t key = 1 + index_first;
+    block_sector_t sector = 0;
+    if (inode->map_indirect_key != key)
+      sector = indirect_block_entry (idisk->doubly_indirect_block, index_first);
+    blocks = inode_indirect_block (inode, key, sector)->blocks;
+
+    index_base += index_first * INDIRECT_BLOCKS_PER_SECTOR;
+    index_limit = index_base + INDIRECT_BLOCKS_PER_SECTOR;
+    goto found;
+  }
 
-    // fetch two indirect block sectors
-    struct inode_indirect_block_sector *indirect_idisk;
-    indirect_idisk = calloc(1, sizeof(struct inode_indirect_block_sector));
+  // (4) what up?
+  return false;
 
-    buffer_cache_read (idisk->doubly_indirect_block, indirect_idisk);
-    buffer_cache_read (indirect_idisk->blocks[index_first], indirect_idisk);
-    ret = indirect_idisk->blocks[index_second];
+found:
+  i = index - index_base;
+  cnt = (num_sectors < index_limit ? num_sectors : index_limit) - index_base;
+  run->index = index;
+  run->sector = blocks[i];
+  run->length = blocks_run_length (blocks, i, cnt);
+  return true;
+}
 
-    free(indirect_idisk);
-    return ret;
+/* Finds the extent among the CNT extents of EXTENTS, whose first
+   sector index is *BASE, that contains sector index INDEX.
+   Advances *BASE past them if there is no such extent. */
+static bool
+extents_lookup (const struct inode_extent *extents, size_t cnt,
+                off_t *base, off_t index, struct inode_run *run)
+{
+  size_t i;
+  for (i = 0; i < cnt; ++ i) {
+    if (index < *base + (off_t) extents[i].length) {
+      run->index = *base;
+      run->sector = extents[i].start;
+      run->length = extents[i].length;
+      return true;
+    }
+    *base += extents[i].length;
   }
+  return false;
+}
 
-  // (4) what up?
-  return -1;
+/* Finds the extent containing sector index INDEX of an
+   INODE_FORMAT_EXTENT inode. */
+static bool
+extent_index_to_run (struct inode *inode, off_t index, struct inode_run *run)
+{
+  const struct inode_disk *idisk = &inode->data;
+  off_t base = 0;
+
+  // (1) extents in the inode
+  if (extents_lookup (idisk->extents, idisk->extent_cnt, &base, index, run))
+    return true;
+
+  // (2) chain of extent blocks
+  block_sector_t next = idisk->extent_block;
+  bool found = false;
+  while (next != 0 && !found) {
+    struct buffer_cache_entry_t *entry = buffer_cache_pin (next);
+    const struct inode_extent_block_sector *block = buffer_cache_borrow (entry);
+    found = extents_lookup (block->extents, block->extent_cnt, &base, index, run);
+    next = block->next;
+    buffer_cache_unpin (entry);
+    map_meta_read_cnt ++;
+  }
+  return found;
 }
 
-/* Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
+/* Translates sector index INDEX of INODE into a disk sector,
+   through the inode's run cache. Returns -1 if not allocated.
+   Otherwise, if RUN_LEFT is not null, stores into it the number of
+   sectors, starting at the returned one, that are consecutive. */
+static block_sector_t
+index_to_sector (struct inode *inode, off_t index, size_t *run_left)
+{
+  struct inode_run *run = &inode->map_run;
+  block_sector_t sector = -1;
+
+  lock_acquire (&inode->map_lock);
+  map_lookup_cnt ++;
+
+  bool found;
+  if (run->length > 0 && run->index <= index && index < run->index + run->length) {
+    map_hit_cnt ++;
+    found = true;
+  }
+  else if (inode->data.version == INODE_FORMAT_EXTENT)
+    found = extent_index_to_run (inode, index, run);
+  else
+    found = indirect_index_to_run (inode, index, run);
+
+  if (found) {
+    sector = run->sector + (index - run->index);
+    if (run_left != NULL)
+      *run_left = run->index + run->length - index;
+  }
+  else
+    run->length = 0;
+  lock_release (&inode->map_lock);
+  return sector;
+}
+
+/* Drops the block-map caches of INODE; must be called, with
+   map_lock held, whenever its block map changes. */
+static void
+inode_map_invalidate (struct inode *inode)
+{
+  inode->map_run.length = 0;
+  inode->map_indirect_key = -1;
+}
+
+/* Like byte_to_sector(), and also stores into *RUN_LEFT, if not
+   null, the number of sectors, starting at the returned one, that
+   hold consecutive data of INODE. */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos)
+byte_to_sector_run (struct inode *inode, off_t pos, size_t *run_left)
 {
   ASSERT (inode != NULL);
   if (0 <= pos && pos < inode->data.length) {
     // sector index
     off_t index = pos / BLOCK_SECTOR_SIZE;
-    return index_to_sector (&inode->data, index);
+    return index_to_sector (inode, index, run_left);
   }
   else
     return -1;
 }
 
+/* Returns the block device sector that contains byte offset POS
+   within INODE.
+   Returns -1 if INODE does not contain data for a byte at offset
+   POS. */
+static block_sector_t
+byte_to_sector (struct inode *inode, off_t pos)
+{
+  return byte_to_sector_run (inode, pos, NULL);
+}
+
 /* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
+   returns the same `struct inode'.  Looking an inode up only
+   takes open_inodes_lock for reading; adding or removing one
+   takes it for writing. */
 static struct list open_inodes;
+static struct rwlock open_inodes_lock;
 
 /* Initializes the inode module. */
 void
 inode_init (void)
 {
   list_init (&open_inodes);
+  rwlock_init (&open_inodes_lock);
+}
+
+/* Returns the open inode for SECTOR, reopened, or a null pointer
+   if there is none.  Must be called with open_inodes_lock held,
+   for reading at least. */
+static struct inode *
+inode_lookup (block_sector_t sector)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e))
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector)
+        return inode_reopen (inode);
+    }
+  return NULL;
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -162,7 +395,8 @@ inode_create (block_sector_t sector, off_t length, bool is_dir)
       disk_inode->length = length;
       disk_inode->magic = INODE_MAGIC;
       disk_inode->is_dir = is_dir;
-      if (inode_allocate (disk_inode))
+      disk_inode->version = inode_format;
+      if (inode_allocate (sector, disk_inode))
         {
           buffer_cache_write (sector, disk_inode);
           success = true;
@@ -178,20 +412,14 @@ inode_create (block_sector_t sector, off_t length, bool is_dir)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
-  struct inode *inode;
+  struct inode *inode, *open;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e))
-    {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector)
-        {
-          inode_reopen (inode);
-          return inode;
-        }
-    }
+  rwlock_acquire_read (&open_inodes_lock);
+  open = inode_lookup (sector);
+  rwlock_release_read (&open_inodes_lock);
+  if (open != NULL)
+    return open;
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
@@ -199,13 +427,28 @@ inode_open (block_sector_t sector)
     return NULL;
 
   /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  inode->readahead_next = 0;
+  inode->readahead_end = 0;
+  lock_init (&inode->map_lock);
+  inode_map_invalidate (inode);
 
   buffer_cache_read (inode->sector, &inode->data);
+
+  /* Someone else may have opened it meanwhile. */
+  rwlock_acquire_write (&open_inodes_lock);
+  open = inode_lookup (sector);
+  if (open == NULL)
+    list_push_front (&open_inodes, &inode->elem);
+  rwlock_release_write (&open_inodes_lock);
+  if (open != NULL)
+    {
+      free (inode);
+      return open;
+    }
   return inode;
 }
 
@@ -214,7 +457,12 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      /* Openers may look INODE up concurrently. */
+      enum intr_level old_level = intr_disable ();
+      inode->open_cnt++;
+      intr_set_level (old_level);
+    }
   return inode;
 }
 
@@ -231,16 +479,25 @@ inode_get_inumber (const struct inode *inode)
 void
 inode_close (struct inode *inode)
 {
+  enum intr_level old_level;
+  bool last;
+
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  rwlock_acquire_write (&open_inodes_lock);
+  old_level = intr_disable ();
+  last = --inode->open_cnt == 0;
+  intr_set_level (old_level);
+  if (last)
+    /* Remove from inode list. */
+    list_remove (&inode->elem);
+  rwlock_release_write (&open_inodes_lock);
+
+  if (last)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
-
       /* Deallocate blocks if removed. */
       if (inode->removed)
         {
@@ -261,6 +518,36 @@ inode_remove (struct inode *inode)
   inode->removed = true;
 }
 
+/* Detects sequential reads of INODE and keeps the buffer cache's
+   read-ahead window filled in front of them.  A read of the
+   sector range [FIRST, LAST] is sequential if it starts where the
+   previous read left off (or within its last, partially consumed
+   sector). */
+static void
+inode_readahead (struct inode *inode, off_t first, off_t last)
+{
+  off_t window = buffer_cache_readahead_window;
+  bool sequential = (first == inode->readahead_next
+                     || first + 1 == inode->readahead_next);
+
+  inode->readahead_next = last + 1;
+  if (!sequential || window == 0) {
+    inode->readahead_end = last + 1;
+    return;
+  }
+
+  // queue the sectors of the window which are not queued yet
+  off_t index = inode->readahead_end > last + 1 ? inode->readahead_end : last + 1;
+  off_t limit = last + 1 + window;
+  off_t length_sectors = bytes_to_sectors (inode->data.length);
+  if (limit > length_sectors) limit = length_sectors;
+
+  for (; index < limit; ++ index)
+    buffer_cache_readahead (byte_to_sector (inode, index * BLOCK_SECTOR_SIZE));
+  if (index > inode->readahead_end)
+    inode->readahead_end = index;
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
@@ -269,12 +556,14 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
+  off_t start = offset;
 
   while (size > 0)
     {
-      /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Disk sector to read, starting byte offset within sector,
+         number of sectors stored consecutively from it. */
+      size_t run_left = 0;
+      block_sector_t sector_idx = byte_to_sector_run (inode, offset, &run_left);
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -289,21 +578,20 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
-          /* Read full sector directly into caller's buffer. */
-          buffer_cache_read (sector_idx, buffer + bytes_read);
+          /* Read full sectors directly into caller's buffer, as
+             many as are consecutive on disk, in one go. */
+          off_t left = size < inode_left ? size : inode_left;
+          size_t cnt = min (run_left, left / BLOCK_SECTOR_SIZE);
+          buffer_cache_read_multiple (sector_idx, cnt, buffer + bytes_read);
+          chunk_size = cnt * BLOCK_SECTOR_SIZE;
         }
       else
         {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL)
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          buffer_cache_read (sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
+          /* Partially copy the cached sector into caller's buffer. */
+          struct buffer_cache_entry_t *entry = buffer_cache_pin (sector_idx);
+          const uint8_t *data = buffer_cache_borrow (entry);
+          memcpy (buffer + bytes_read, data + sector_ofs, chunk_size);
+          buffer_cache_unpin (entry);
         }
 
       /* Advance. */
@@ -311,7 +599,10 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
+
+  if (bytes_read > 0)
+    inode_readahead (inode, start / BLOCK_SECTOR_SIZE,
+                     (start + bytes_read - 1) / BLOCK_SECTOR_SIZE);
 
   return bytes_read;
 }
@@ -327,7 +618,6 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
 
   if (inode->deny_write_cnt)
     return 0;
@@ -336,18 +626,24 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   if( byte_to_sector(inode, offset + size - 1) == -1u ) {
     // extend and reserve up to [offset + size] bytes
     bool success;
-    success = inode_reserve (& inode->data, offset + size);
+    lock_acquire (&inode->map_lock);
+    success = inode_reserve (inode->sector, & inode->data, offset + size);
+    inode_map_invalidate (inode);
+    if (success) {
+      // write back the (extended) file size
+      inode->data.length = offset + size;
+      buffer_cache_write (inode->sector, & inode->data);
+    }
+    lock_release (&inode->map_lock);
     if (!success) return 0;  // fail?
-
-    // write back the (extended) file size
-    inode->data.length = offset + size;
-    buffer_cache_write (inode->sector, & inode->data);
   }
 
   while (size > 0)
     {
-      /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Sector to write, starting byte offset within sector,
+         number of sectors stored consecutively from it. */
+      size_t run_left = 0;
+      block_sector_t sector_idx = byte_to_sector_run (inode, offset, &run_left);
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -362,28 +658,21 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
-          /* Write full sector directly to disk. */
-          buffer_cache_write (sector_idx, buffer + bytes_written);
+          /* Write full sectors directly to the cache, as many as
+             are consecutive on disk, in one go. */
+          off_t left = size < inode_left ? size : inode_left;
+          size_t cnt = min (run_left, left / BLOCK_SECTOR_SIZE);
+          buffer_cache_write_multiple (sector_idx, cnt, buffer + bytes_written);
+          chunk_size = cnt * BLOCK_SECTOR_SIZE;
         }
       else
         {
-          /* We need a bounce buffer. */
-          if (bounce == NULL)
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left)
-            buffer_cache_read (sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          buffer_cache_write (sector_idx, bounce);
+          /* The sector contains data before or after the chunk
+             we're writing: modify the cached sector in place. */
+          struct buffer_cache_entry_t *entry = buffer_cache_pin_mut (sector_idx);
+          uint8_t *data = buffer_cache_borrow_mut (entry);
+          memcpy (data + sector_ofs, buffer + bytes_written, chunk_size);
+          buffer_cache_unpin (entry);
         }
 
       /* Advance. */
@@ -391,7 +680,6 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
 
   return bytes_written;
 }
@@ -437,10 +725,141 @@ inode_is_removed (const struct inode *inode)
   return inode->removed;
 }
 
+/* Returns the on-disk format of INODE. */
+enum inode_format
+inode_get_format (const struct inode *inode)
+{
+  return inode->data.version;
+}
+
 static
-bool inode_allocate (struct inode_disk *disk_inode)
+bool inode_allocate (block_sector_t sector, struct inode_disk *disk_inode)
 {
-  return inode_reserve (disk_inode, disk_inode->length);
+  return inode_reserve (sector, disk_inode, disk_inode->length);
+}
+
+/**
+ * Appends the run of `cnt` sectors starting at `start` to the extents
+ * of `idisk`, merging it into the last extent if they are contiguous.
+ * Returns false if a new extent block could not be allocated.
+ */
+static bool
+inode_extent_append (struct inode_disk *idisk, block_sector_t start, size_t cnt)
+{
+  // (1) extents in the inode
+  if (idisk->extent_block == 0) {
+    if (idisk->extent_cnt > 0) {
+      struct inode_extent *last = &idisk->extents[idisk->extent_cnt - 1];
+      if (last->start + last->length == start) {
+        last->length += cnt;
+        return true;
+      }
+    }
+    if (idisk->extent_cnt < INODE_EXTENTS_COUNT) {
+      idisk->extents[idisk->extent_cnt].start = start;
+      idisk->extents[idisk->extent_cnt].length = cnt;
+      idisk->extent_cnt ++;
+      return true;
+    }
+  }
+
+  // (2) the last extent block, if it has any room
+  struct buffer_cache_entry_t *entry = NULL;
+  struct inode_extent_block_sector *tail = NULL;
+  if (idisk->extent_tail != 0) {
+    entry = buffer_cache_pin_mut (idisk->extent_tail);
+    tail = buffer_cache_borrow_mut (entry);
+
+    struct inode_extent *last = &tail->extents[tail->extent_cnt - 1];
+    if (last->start + last->length == start) {
+      last->length += cnt;
+      buffer_cache_unpin (entry);
+      return true;
+    }
+    if (tail->extent_cnt < EXTENTS_PER_BLOCK) {
+      tail->extents[tail->extent_cnt].start = start;
+      tail->extents[tail->extent_cnt].length = cnt;
+      tail->extent_cnt ++;
+      buffer_cache_unpin (entry);
+      return true;
+    }
+  }
+
+  // (3) chain a new extent block
+  struct inode_extent_block_sector *block = calloc (1, sizeof *block);
+  block_sector_t sector;
+  if (block == NULL || ! free_map_allocate (1, &sector)) {
+    free (block);
+    if (entry != NULL) buffer_cache_unpin (entry);
+    return false;
+  }
+  block->extent_cnt = 1;
+  block->extents[0].start = start;
+  block->extents[0].length = cnt;
+  buffer_cache_write (sector, block);
+  free (block);
+
+  if (tail != NULL) {
+    tail->next = sector;
+    buffer_cache_unpin (entry);
+  }
+  else
+    idisk->extent_block = sector;
+  idisk->extent_tail = sector;
+  return true;
+}
+
+/* Returns the sector right after the last extent of IDISK,
+   or -1 if IDISK has no extent yet. */
+static block_sector_t
+inode_extent_end (const struct inode_disk *idisk)
+{
+  block_sector_t end = -1;
+  if (idisk->extent_tail != 0) {
+    struct buffer_cache_entry_t *entry = buffer_cache_pin (idisk->extent_tail);
+    const struct inode_extent_block_sector *tail = buffer_cache_borrow (entry);
+    end = tail->extents[tail->extent_cnt - 1].start
+        + tail->extents[tail->extent_cnt - 1].length;
+    buffer_cache_unpin (entry);
+  }
+  else if (idisk->extent_cnt > 0) {
+    end = idisk->extents[idisk->extent_cnt - 1].start
+        + idisk->extents[idisk->extent_cnt - 1].length;
+  }
+  return end;
+}
+
+/**
+ * Extend the extents of an inode at `sector`, so that the file can
+ * hold at least `length` bytes. Runs are allocated as contiguously
+ * as possible, right after the last extent (or the inode itself).
+ */
+static bool
+inode_reserve_extents (block_sector_t sector, struct inode_disk *disk_inode,
+                       off_t length)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+  size_t num_sectors = bytes_to_sectors(length);
+
+  while (disk_inode->sector_cnt < num_sectors) {
+    block_sector_t goal = inode_extent_end (disk_inode);
+    if (goal == (block_sector_t) -1) goal = sector + 1;
+
+    block_sector_t start;
+    size_t i, cnt;
+    if (! free_map_allocate_near (num_sectors - disk_inode->sector_cnt, goal,
+                                  &start, &cnt))
+      return false;
+    if (! inode_extent_append (disk_inode, start, cnt)) {
+      free_map_release (start, cnt);
+      return false;
+    }
+    disk_inode->sector_cnt += cnt;
+
+    for (i = 0; i < cnt; ++ i)
+      buffer_cache_write (start + i, zeros);
+  }
+  return true;
 }
 
 static bool
@@ -489,11 +908,15 @@ inode_reserve_indirect (block_sector_t* p_entry, size_t num_sectors, int level)
  * `length` bytes.
  */
 static bool
-inode_reserve (struct inode_disk *disk_inode, off_t length)
+inode_reserve (block_sector_t sector, struct inode_disk *disk_inode,
+               off_t length)
 {
   static char zeros[BLOCK_SECTOR_SIZE];
   if (length < 0) return false;
 
+  if (disk_inode->version == INODE_FORMAT_EXTENT)
+    return inode_reserve_extents (sector, disk_inode, length);
+
   // (remaining) number of sectors, occupied by this file.
   size_t num_sectors = bytes_to_sectors(length);
   size_t i, l;
@@ -555,11 +978,40 @@ inode_deallocate_indirect (block_sector_t entry, size_t num_sectors, int level)
   free_map_release (entry, 1);
 }
 
+static void
+inode_deallocate_extents (struct inode_disk *idisk)
+{
+  size_t i;
+
+  // (1) extents in the inode
+  for (i = 0; i < idisk->extent_cnt; ++ i)
+    free_map_release (idisk->extents[i].start, idisk->extents[i].length);
+
+  // (2) chain of extent blocks
+  block_sector_t next = idisk->extent_block;
+  while (next != 0) {
+    struct inode_extent_block_sector block;
+    buffer_cache_read (next, &block);
+    for (i = 0; i < block.extent_cnt; ++ i)
+      free_map_release (block.extents[i].start, block.extents[i].length);
+    free_map_release (next, 1);
+    next = block.next;
+  }
+}
+
 static
 bool inode_deallocate (struct inode *inode)
 {
   off_t file_length = inode->data.length; // bytes
   if(file_length < 0) return false;
+  lock_acquire (&inode->map_lock);
+  inode_map_invalidate (inode);
+  lock_release (&inode->map_lock);
+
+  if (inode->data.version == INODE_FORMAT_EXTENT) {
+    inode_deallocate_extents (&inode->data);
+    return true;
+  }
 
   // (remaining) number of sectors, occupied by this file.
   size_t num_sectors = bytes_to_sectors(file_length);
@@ -590,3 +1042,12 @@ bool inode_deallocate (struct inode *inode)
   return true;
 }
 
+
+/* Prints block-map translation statistics. */
+void
+inode_print_stats (void)
+{
+  printf ("Inode block map: %llu lookups, %llu from the run cache, "
+          "%llu block-map sectors read\n",
+          map_lookup_cnt, map_hit_cnt, map_meta_read_cnt);
+}
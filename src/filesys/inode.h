@@ -7,6 +7,18 @@
 
 struct bitmap;
 
+/* On-disk inode formats. */
+enum inode_format
+  {
+    INODE_FORMAT_INDIRECT = 0,  /* Direct, indirect and doubly indirect blocks. */
+    INODE_FORMAT_EXTENT = 1     /* Runs of consecutive sectors. */
+  };
+
+/* Format of the inodes created from now on.  Chosen by the
+   "-fsformat" kernel command-line option when formatting, and
+   taken from the root directory when mounting. */
+extern enum inode_format inode_format;
+
 void inode_init (void);
 bool inode_create (block_sector_t, off_t, bool);
 struct inode *inode_open (block_sector_t);
@@ -21,5 +33,8 @@ void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
 bool inode_is_directory (const struct inode *);
 bool inode_is_removed (const struct inode *);
+enum inode_format inode_get_format (const struct inode *);
+
+void inode_print_stats (void);
 
 #endif /* filesys/inode.h */
@@ -358,6 +358,28 @@ bitmap_write (const struct bitmap *b, struct file *file)
   off_t size = byte_cnt (b->bit_cnt);
   return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* Writes the part of B that holds the CNT bits starting at
+   START to FILE, where B was written by bitmap_write().  Only
+   the elements containing those bits are written.  Return true
+   if successful, false otherwise. */
+bool
+bitmap_write_partial (const struct bitmap *b, struct file *file,
+                      size_t start, size_t cnt)
+{
+  ASSERT (b != NULL);
+  ASSERT (start <= b->bit_cnt);
+  ASSERT (start + cnt <= b->bit_cnt);
+
+  if (cnt == 0)
+    return true;
+
+  size_t first = elem_idx (start);
+  size_t last = elem_idx (start + cnt - 1);
+  off_t ofs = first * sizeof (elem_type);
+  off_t size = (last - first + 1) * sizeof (elem_type);
+  return file_write_at (file, b->bits + first, size, ofs) == size;
+}
 #endif /* FILESYS */
 
 /* Debugging. */
@@ -0,0 +1,156 @@
+#include "lzf.h"
+#include <debug.h>
+#include <string.h>
+
+/* Longest back reference, and farthest back it can reach. */
+#define MAX_REF ((7 + 255) + 2)
+#define MAX_OFF (1 << 13)
+
+/* Longest literal run. */
+#define MAX_LIT 32
+
+/* Returns the hash of the 3 bytes at P. */
+static inline unsigned
+hash3 (const uint8_t *p)
+{
+  uint32_t v = ((uint32_t) p[0] << 16) | (p[1] << 8) | p[2];
+  return (v * 2654435761u) >> (32 - LZF_HLOG);
+}
+
+/* Compresses the IN_LEN bytes at IN into the OUT_LEN bytes at
+   OUT, using HTAB as scratch space.  Returns the size of the
+   compressed data, or 0 if it does not fit in OUT_LEN bytes. */
+size_t
+lzf_compress (const void *in_, size_t in_len, void *out_, size_t out_len,
+              uint16_t htab[LZF_HTAB_SIZE])
+{
+  const uint8_t *in = in_;
+  uint8_t *out = out_;
+  size_t ip = 0, op = 0;
+  size_t lit_pos, lit = 0;
+
+  ASSERT (in_len <= LZF_MAX_INPUT);
+
+  /* Positions are stored plus one, so that 0 means none. */
+  memset (htab, 0, LZF_HTAB_SIZE * sizeof *htab);
+
+  /* Each literal run starts with a control byte, filled in when
+     the run ends. */
+  if (out_len == 0)
+    return 0;
+  lit_pos = op++;
+
+  while (ip < in_len)
+    {
+      if (ip + 2 < in_len)
+        {
+          unsigned h = hash3 (in + ip);
+          size_t ref = htab[h];
+          htab[h] = ip + 1;
+
+          if (ref != 0 && ip - ref < MAX_OFF
+              && !memcmp (in + ref - 1, in + ip, 3))
+            {
+              size_t off = ip - ref;
+              size_t max_len = in_len - ip < MAX_REF ? in_len - ip : MAX_REF;
+              size_t len = 3;
+
+              ref--;
+              while (len < max_len && in[ref + len] == in[ip + len])
+                len++;
+
+              /* End the literal run, or take back its control
+                 byte if it is empty. */
+              if (lit == 0)
+                op--;
+              else
+                out[lit_pos] = lit - 1;
+
+              /* The reference, and the next run's control byte. */
+              if (op + 4 > out_len)
+                return 0;
+              if (len - 2 < 7)
+                out[op++] = ((len - 2) << 5) | (off >> 8);
+              else
+                {
+                  out[op++] = (7 << 5) | (off >> 8);
+                  out[op++] = len - 2 - 7;
+                }
+              out[op++] = off & 0xff;
+              ip += len;
+
+              lit_pos = op++;
+              lit = 0;
+              continue;
+            }
+        }
+
+      /* A literal byte. */
+      if (op >= out_len)
+        return 0;
+      out[op++] = in[ip++];
+      if (++lit == MAX_LIT)
+        {
+          out[lit_pos] = lit - 1;
+          if (op >= out_len)
+            return 0;
+          lit_pos = op++;
+          lit = 0;
+        }
+    }
+
+  if (lit == 0)
+    op--;
+  else
+    out[lit_pos] = lit - 1;
+  return op;
+}
+
+/* Decompresses the IN_LEN bytes at IN into the OUT_LEN bytes at
+   OUT.  Returns the size of the decompressed data, or 0 if the
+   data is corrupt or does not fit. */
+size_t
+lzf_decompress (const void *in_, size_t in_len, void *out_, size_t out_len)
+{
+  const uint8_t *in = in_;
+  uint8_t *out = out_;
+  size_t ip = 0, op = 0;
+
+  while (ip < in_len)
+    {
+      unsigned ctrl = in[ip++];
+
+      if (ctrl < MAX_LIT)
+        {
+          size_t len = ctrl + 1;
+          if (ip + len > in_len || op + len > out_len)
+            return 0;
+          memcpy (out + op, in + ip, len);
+          ip += len;
+          op += len;
+        }
+      else
+        {
+          size_t len = ctrl >> 5;
+          size_t off;
+
+          if (len == 7)
+            {
+              if (ip >= in_len)
+                return 0;
+              len += in[ip++];
+            }
+          len += 2;
+          if (ip >= in_len)
+            return 0;
+          off = ((ctrl & 0x1f) << 8) + in[ip++] + 1;
+          if (off > op || op + len > out_len)
+            return 0;
+
+          /* Byte by byte: the source may overlap the copy. */
+          for (; len > 0; len--, op++)
+            out[op] = out[op - off];
+        }
+    }
+  return op;
+}
@@ -0,0 +1,35 @@
+#ifndef __LIB_KERNEL_LZF_H
+#define __LIB_KERNEL_LZF_H
+
+/* LZF-style compression.
+
+   A small and fast LZ77 codec, meant for memory pages.  The
+   compressed data is a sequence of items, each starting with a
+   control byte C:
+
+     - C < 32: a run of C + 1 literal bytes follows.
+
+     - Otherwise, a back reference: copy L + 2 bytes starting O
+       bytes back in the output, where L is C >> 5, plus the
+       following byte if L is 7, and O is 1 + ((C & 0x1f) << 8)
+       plus the next byte.
+
+   Matches are found with a hash table of recent positions, that
+   the caller provides so that it need not live on a kernel stack. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of entries in the hash table passed to lzf_compress(). */
+#define LZF_HLOG 10
+#define LZF_HTAB_SIZE (1u << LZF_HLOG)
+
+/* Largest input lzf_compress() accepts. */
+#define LZF_MAX_INPUT 65535
+
+size_t lzf_compress (const void *in, size_t in_len, void *out, size_t out_len,
+                     uint16_t htab[LZF_HTAB_SIZE]);
+size_t lzf_decompress (const void *in, size_t in_len,
+                       void *out, size_t out_len);
+
+#endif /* lib/kernel/lzf.h */
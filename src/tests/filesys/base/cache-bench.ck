@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+my (%hits) = get_bench_results
+  (qr/^cachebench: (\d+) readers: (\d+) ns per hit, (\d+) hits\/s, (\d+) misses$/,
+   1, 4, 16);
+
+# Every read should hit, and readers holding a shard lock for
+# reading (even when preempted) should not hold the others up, so
+# the hit rate should not fall by much with more of them.
+foreach my $reader_cnt (1, 4, 16) {
+    my ($ns, $rate, $misses) = @{$hits{$reader_cnt}};
+    fail "No hits with $reader_cnt readers.\n" if $rate == 0;
+    fail "$misses misses with $reader_cnt readers, expected none.\n"
+      if $misses != 0;
+}
+fail "$hits{16}[1] hits/s with 16 readers "
+  . "is less than half of $hits{1}[1] with 1 reader.\n"
+  if $hits{16}[1] * 2 < $hits{1}[1];
+pass;
@@ -0,0 +1,6 @@
+/* Spawns a single child process, which repeatedly reads a small
+   file that stays resident in the buffer cache.  All but the
+   first pass over the file must be served by cache hits. */
+
+#define CHILD_CNT 1
+#include "tests/filesys/base/cache-read.inc"
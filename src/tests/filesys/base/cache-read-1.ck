@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-read-1) begin
+(cache-read-1) create "hot"
+(cache-read-1) open "hot"
+(cache-read-1) write "hot"
+(cache-read-1) close "hot"
+(cache-read-1) exec child 1 of 1: "child-cache-read 0"
+(cache-read-1) wait for child 1 of 1 returned 0 (expected 0)
+(cache-read-1) end
+EOF
+
+# Each child reads the 16 sectors of the file 16 times over.
+my ($hits) = get_stats (qr/^Buffer cache: (\d+) hits/,
+			read_text_file ("$test.output"));
+fail "$hits buffer cache hits, expected at least 240.\n" if $hits < 240;
+pass;
@@ -0,0 +1,7 @@
+/* Spawns 16 child processes, all of which repeatedly read the
+   same small file, which stays resident in the buffer cache.
+   All but the first pass of each child over the file must be
+   served by cache hits. */
+
+#define CHILD_CNT 16
+#include "tests/filesys/base/cache-read.inc"
@@ -0,0 +1,51 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-read-16) begin
+(cache-read-16) create "hot"
+(cache-read-16) open "hot"
+(cache-read-16) write "hot"
+(cache-read-16) close "hot"
+(cache-read-16) exec child 1 of 16: "child-cache-read 0"
+(cache-read-16) exec child 2 of 16: "child-cache-read 1"
+(cache-read-16) exec child 3 of 16: "child-cache-read 2"
+(cache-read-16) exec child 4 of 16: "child-cache-read 3"
+(cache-read-16) exec child 5 of 16: "child-cache-read 4"
+(cache-read-16) exec child 6 of 16: "child-cache-read 5"
+(cache-read-16) exec child 7 of 16: "child-cache-read 6"
+(cache-read-16) exec child 8 of 16: "child-cache-read 7"
+(cache-read-16) exec child 9 of 16: "child-cache-read 8"
+(cache-read-16) exec child 10 of 16: "child-cache-read 9"
+(cache-read-16) exec child 11 of 16: "child-cache-read 10"
+(cache-read-16) exec child 12 of 16: "child-cache-read 11"
+(cache-read-16) exec child 13 of 16: "child-cache-read 12"
+(cache-read-16) exec child 14 of 16: "child-cache-read 13"
+(cache-read-16) exec child 15 of 16: "child-cache-read 14"
+(cache-read-16) exec child 16 of 16: "child-cache-read 15"
+(cache-read-16) wait for child 1 of 16 returned 0 (expected 0)
+(cache-read-16) wait for child 2 of 16 returned 1 (expected 1)
+(cache-read-16) wait for child 3 of 16 returned 2 (expected 2)
+(cache-read-16) wait for child 4 of 16 returned 3 (expected 3)
+(cache-read-16) wait for child 5 of 16 returned 4 (expected 4)
+(cache-read-16) wait for child 6 of 16 returned 5 (expected 5)
+(cache-read-16) wait for child 7 of 16 returned 6 (expected 6)
+(cache-read-16) wait for child 8 of 16 returned 7 (expected 7)
+(cache-read-16) wait for child 9 of 16 returned 8 (expected 8)
+(cache-read-16) wait for child 10 of 16 returned 9 (expected 9)
+(cache-read-16) wait for child 11 of 16 returned 10 (expected 10)
+(cache-read-16) wait for child 12 of 16 returned 11 (expected 11)
+(cache-read-16) wait for child 13 of 16 returned 12 (expected 12)
+(cache-read-16) wait for child 14 of 16 returned 13 (expected 13)
+(cache-read-16) wait for child 15 of 16 returned 14 (expected 14)
+(cache-read-16) wait for child 16 of 16 returned 15 (expected 15)
+(cache-read-16) end
+EOF
+
+# Each child reads the 16 sectors of the file 16 times over.
+my ($hits) = get_stats (qr/^Buffer cache: (\d+) hits/,
+			read_text_file ("$test.output"));
+fail "$hits buffer cache hits, expected at least 3840.\n" if $hits < 3840;
+pass;
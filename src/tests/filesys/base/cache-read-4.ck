@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-read-4) begin
+(cache-read-4) create "hot"
+(cache-read-4) open "hot"
+(cache-read-4) write "hot"
+(cache-read-4) close "hot"
+(cache-read-4) exec child 1 of 4: "child-cache-read 0"
+(cache-read-4) exec child 2 of 4: "child-cache-read 1"
+(cache-read-4) exec child 3 of 4: "child-cache-read 2"
+(cache-read-4) exec child 4 of 4: "child-cache-read 3"
+(cache-read-4) wait for child 1 of 4 returned 0 (expected 0)
+(cache-read-4) wait for child 2 of 4 returned 1 (expected 1)
+(cache-read-4) wait for child 3 of 4 returned 2 (expected 2)
+(cache-read-4) wait for child 4 of 4 returned 3 (expected 3)
+(cache-read-4) end
+EOF
+
+# Each child reads the 16 sectors of the file 16 times over.
+my ($hits) = get_stats (qr/^Buffer cache: (\d+) hits/,
+			read_text_file ("$test.output"));
+fail "$hits buffer cache hits, expected at least 960.\n" if $hits < 960;
+pass;
@@ -0,0 +1,10 @@
+#ifndef TESTS_FILESYS_BASE_CACHE_READ_H
+#define TESTS_FILESYS_BASE_CACHE_READ_H
+
+/* Small enough to stay resident in the buffer cache, so that
+   after the first pass every read is a cache hit. */
+#define BUF_SIZE 8192
+#define READ_PASSES 16
+static const char file_name[] = "hot";
+
+#endif /* tests/filesys/base/cache-read.h */
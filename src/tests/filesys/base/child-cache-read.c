@@ -0,0 +1,47 @@
+/* Child process for cache-read tests.
+   Reads the test file one sector-sized block at a time,
+   READ_PASSES times over, verifying the contents each time. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/cache-read.h"
+
+const char *test_name = "child-cache-read";
+
+static char buf[BUF_SIZE];
+
+int
+main (int argc, const char *argv[]) 
+{
+  int child_idx;
+  int fd;
+  int pass;
+  size_t ofs;
+
+  quiet = true;
+  
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (pass = 0; pass < READ_PASSES; pass++) 
+    {
+      seek (fd, 0);
+      for (ofs = 0; ofs < sizeof buf; ofs += 512) 
+        {
+          char block[512];
+          CHECK (read (fd, block, sizeof block) == (int) sizeof block,
+                 "read \"%s\"", file_name);
+          compare_bytes (block, buf + ofs, sizeof block, ofs, file_name);
+        }
+    }
+  close (fd);
+
+  return child_idx;
+}
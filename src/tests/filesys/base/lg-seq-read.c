@@ -0,0 +1,62 @@
+/* Writes a 1 MB file sequentially, then reads it back
+   sequentially, one sector at a time.
+   The "Inode block map" statistics printed at shutdown show how
+   many sector lookups the inode's block-map cache served without
+   reading an indirect or extent block. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (1024 * 1024)
+
+static char buf[4096];
+
+/* Fills DST with the SIZE bytes of the file at offset OFS. */
+static void
+fill (char *dst, size_t ofs, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    dst[i] = (ofs + i) * 7 + (ofs + i) / 4096;
+}
+
+void
+test_main (void)
+{
+  char block[512];
+  size_t ofs;
+  int fd;
+
+  CHECK (create ("big", 0), "create \"big\"");
+  CHECK ((fd = open ("big")) > 1, "open \"big\"");
+
+  msg ("writing \"big\"");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    {
+      fill (buf, ofs, sizeof buf);
+      if (write (fd, buf, sizeof buf) != (int) sizeof buf)
+        fail ("write %zu bytes at offset %zu in \"big\" failed",
+              sizeof buf, ofs);
+    }
+
+  msg ("close \"big\"");
+  close (fd);
+
+  CHECK ((fd = open ("big")) > 1, "open \"big\" for verification");
+  quiet = true;
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof block)
+    {
+      if (read (fd, block, sizeof block) != (int) sizeof block)
+        fail ("read %zu bytes at offset %zu in \"big\" failed",
+              sizeof block, ofs);
+      fill (buf, ofs, sizeof block);
+      compare_bytes (block, buf, sizeof block, ofs, "big");
+    }
+  quiet = false;
+  msg ("verified contents of \"big\"");
+
+  msg ("close \"big\"");
+  close (fd);
+}
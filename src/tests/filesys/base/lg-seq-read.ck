@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(lg-seq-read) begin
+(lg-seq-read) create "big"
+(lg-seq-read) open "big"
+(lg-seq-read) writing "big"
+(lg-seq-read) close "big"
+(lg-seq-read) open "big" for verification
+(lg-seq-read) verified contents of "big"
+(lg-seq-read) close "big"
+(lg-seq-read) end
+EOF
+pass;
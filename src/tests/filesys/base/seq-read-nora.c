@@ -0,0 +1,7 @@
+/* Writes out a large file sequentially, then reads it back
+   sector by sector with the buffer cache's read-ahead disabled (-ra=0).
+   No sector may be read ahead. */
+
+#define TEST_SIZE 102400
+#define BLOCK_SIZE 4096
+#include "tests/filesys/base/seq-block.inc"
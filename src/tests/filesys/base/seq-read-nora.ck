@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(seq-read-nora) begin
+(seq-read-nora) create "noodle"
+(seq-read-nora) open "noodle"
+(seq-read-nora) writing "noodle"
+(seq-read-nora) close "noodle"
+(seq-read-nora) open "noodle" for verification
+(seq-read-nora) verified contents of "noodle"
+(seq-read-nora) close "noodle"
+(seq-read-nora) end
+EOF
+
+my ($readahead) = get_stats (qr/^Buffer cache: .* (\d+) read-ahead$/,
+			     read_text_file ("$test.output"));
+fail "$readahead sectors read ahead with -ra=0.\n" if $readahead != 0;
+pass;
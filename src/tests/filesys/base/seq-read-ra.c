@@ -0,0 +1,8 @@
+/* Writes out a large file sequentially, then reads it back
+   sector by sector with the buffer cache's read-ahead enabled.
+   Read-ahead must load part of the file, and the contents read
+   back must be intact. */
+
+#define TEST_SIZE 102400
+#define BLOCK_SIZE 4096
+#include "tests/filesys/base/seq-block.inc"
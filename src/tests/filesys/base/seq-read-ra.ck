@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(seq-read-ra) begin
+(seq-read-ra) create "noodle"
+(seq-read-ra) open "noodle"
+(seq-read-ra) writing "noodle"
+(seq-read-ra) close "noodle"
+(seq-read-ra) open "noodle" for verification
+(seq-read-ra) verified contents of "noodle"
+(seq-read-ra) close "noodle"
+(seq-read-ra) end
+EOF
+
+# The verification reads the file sequentially, which must trigger
+# read-ahead.
+my ($readahead) = get_stats (qr/^Buffer cache: .* (\d+) read-ahead$/,
+			     read_text_file ("$test.output"));
+fail "No sector was read ahead.\n" if $readahead == 0;
+pass;
@@ -0,0 +1,8 @@
+/* Writes out a large file sequentially, one sector at a time,
+   with the buffer cache's write-behind disabled (-wb=0), then
+   reads it back to verify it.
+   No sector may be written back by write-behind. */
+
+#define TEST_SIZE 102400
+#define BLOCK_SIZE 512
+#include "tests/filesys/base/seq-block.inc"
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(seq-write-nowb) begin
+(seq-write-nowb) create "noodle"
+(seq-write-nowb) open "noodle"
+(seq-write-nowb) writing "noodle"
+(seq-write-nowb) close "noodle"
+(seq-write-nowb) open "noodle" for verification
+(seq-write-nowb) verified contents of "noodle"
+(seq-write-nowb) close "noodle"
+(seq-write-nowb) end
+EOF
+
+my ($writebehind) = get_stats (qr/^Buffer cache: .*, (\d+) by write-behind$/,
+				read_text_file ("$test.output"));
+fail "$writebehind sectors written back by write-behind with -wb=0.\n"
+  if $writebehind != 0;
+pass;
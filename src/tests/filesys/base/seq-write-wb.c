@@ -0,0 +1,8 @@
+/* Writes out a large file sequentially, one sector at a time,
+   with the buffer cache's write-behind daemon running every 10
+   ticks (-wb=10), then reads it back to verify it.
+   The daemon must write back some of the sectors meanwhile. */
+
+#define TEST_SIZE 102400
+#define BLOCK_SIZE 512
+#include "tests/filesys/base/seq-block.inc"
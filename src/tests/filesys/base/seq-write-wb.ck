@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(seq-write-wb) begin
+(seq-write-wb) create "noodle"
+(seq-write-wb) open "noodle"
+(seq-write-wb) writing "noodle"
+(seq-write-wb) close "noodle"
+(seq-write-wb) open "noodle" for verification
+(seq-write-wb) verified contents of "noodle"
+(seq-write-wb) close "noodle"
+(seq-write-wb) end
+EOF
+
+my ($writebehind) = get_stats (qr/^Buffer cache: .*, (\d+) by write-behind$/,
+				read_text_file ("$test.output"));
+fail "No sector was written back by write-behind.\n" if $writebehind == 0;
+pass;
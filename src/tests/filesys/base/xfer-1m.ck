@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(xfer-1m) begin
+(xfer-1m) create "xfer"
+(xfer-1m) open "xfer"
+(xfer-1m) writing "xfer"
+(xfer-1m) reading "xfer"
+(xfer-1m) verified contents of "xfer"
+(xfer-1m) close "xfer"
+(xfer-1m) end
+EOF
+
+# Reading the file back takes 2,048 sector reads; writing it should
+# take none.
+my ($reads) = get_stats (qr/^\S+ \(filesys\): (\d+) reads, \d+ writes$/,
+			 read_text_file ("$test.output"));
+fail "$reads reads from the file system device, expected fewer than 3072.\n"
+  if $reads >= 3072;
+pass;
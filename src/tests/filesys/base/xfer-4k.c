@@ -0,0 +1,7 @@
+/* Writes a 1 MB file, then reads it back, 4 kB per system
+   call, verifying its contents.  Whole sectors are overwritten
+   without being read from disk first, so the file system device
+   must see fewer than 1.5 reads per sector of the file. */
+
+#define XFER_SIZE 4096
+#include "tests/filesys/base/xfer.inc"
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(xfer-4k) begin
+(xfer-4k) create "xfer"
+(xfer-4k) open "xfer"
+(xfer-4k) writing "xfer"
+(xfer-4k) reading "xfer"
+(xfer-4k) verified contents of "xfer"
+(xfer-4k) close "xfer"
+(xfer-4k) end
+EOF
+
+# Reading the file back takes 2,048 sector reads; writing it should
+# take none.
+my ($reads) = get_stats (qr/^\S+ \(filesys\): (\d+) reads, \d+ writes$/,
+			 read_text_file ("$test.output"));
+fail "$reads reads from the file system device, expected fewer than 3072.\n"
+  if $reads >= 3072;
+pass;
@@ -0,0 +1,7 @@
+/* Grows two files from 0 bytes to 36,000 bytes each, 1,234 bytes
+   at a time in turn, on a file system with extent inodes, then
+   reads them back sequentially.  The files must be allocated in
+   runs of several sectors, and read back intact. */
+
+#define TEST_SIZE 36000
+#include "tests/filesys/extended/grow-seq-two.inc"
@@ -0,0 +1,31 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-seq-extent) begin
+(grow-seq-extent) create "a"
+(grow-seq-extent) create "b"
+(grow-seq-extent) open "a"
+(grow-seq-extent) open "b"
+(grow-seq-extent) grow "a" and "b" alternately
+(grow-seq-extent) close "a"
+(grow-seq-extent) close "b"
+(grow-seq-extent) open "a" for verification
+(grow-seq-extent) verified contents of "a"
+(grow-seq-extent) close "a"
+(grow-seq-extent) open "b" for verification
+(grow-seq-extent) verified contents of "b"
+(grow-seq-extent) close "b"
+(grow-seq-extent) end
+EOF
+
+# Extent inodes allocate runs of sectors, not one sector at a time.
+my ($sectors, $runs)
+  = get_stats (qr/^Free map: (\d+) sectors allocated in (\d+) runs$/,
+	       read_text_file ("$test.output"));
+fail "$sectors sectors allocated in $runs runs, expected fewer runs.\n"
+  if $runs >= $sectors;
+pass;
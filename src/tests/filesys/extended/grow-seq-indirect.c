@@ -0,0 +1,8 @@
+/* Grows two files from 0 bytes to 36,000 bytes each, 1,234 bytes
+   at a time in turn, on a file system with indirect-block inodes
+   (-fsformat=indirect), then reads them back sequentially.  The
+   files must be allocated one sector at a time, and read back
+   intact. */
+
+#define TEST_SIZE 36000
+#include "tests/filesys/extended/grow-seq-two.inc"
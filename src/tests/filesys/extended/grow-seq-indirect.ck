@@ -0,0 +1,31 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-seq-indirect) begin
+(grow-seq-indirect) create "a"
+(grow-seq-indirect) create "b"
+(grow-seq-indirect) open "a"
+(grow-seq-indirect) open "b"
+(grow-seq-indirect) grow "a" and "b" alternately
+(grow-seq-indirect) close "a"
+(grow-seq-indirect) close "b"
+(grow-seq-indirect) open "a" for verification
+(grow-seq-indirect) verified contents of "a"
+(grow-seq-indirect) close "a"
+(grow-seq-indirect) open "b" for verification
+(grow-seq-indirect) verified contents of "b"
+(grow-seq-indirect) close "b"
+(grow-seq-indirect) end
+EOF
+
+# Indirect-block inodes allocate one sector at a time.
+my ($sectors, $runs)
+  = get_stats (qr/^Free map: (\d+) sectors allocated in (\d+) runs$/,
+	       read_text_file ("$test.output"));
+fail "$sectors sectors allocated in $runs runs, expected one per sector.\n"
+  if $runs != $sectors;
+pass;
@@ -152,6 +152,50 @@ sub get_core_output {
     return @output[$start...$end];
 }
 
+# get_stats ($RE, @OUTPUT)
+#
+# Returns the values captured by $RE from the first line of @OUTPUT
+# that it matches, e.g. from the statistics printed at shutdown.
+# Fails if no line matches.
+sub get_stats {
+    my ($re, @output) = @_;
+
+    local ($_);
+    foreach (@output) {
+	my (@values) = /$re/ or next;
+	return @values;
+    }
+    fail "Output lacks a line matching /$re/.\n";
+}
+
+# get_bench_results ($RE, @PARAMS)
+#
+# Checks the output of a benchmark that prints one result line
+# per parameter, matched by $RE with the parameter as its first
+# group.  The benchmark is a test or program that was run, or
+# else a kernel action.  Fails unless there is a line for each
+# of @PARAMS, in that order.  Returns a hash from each parameter
+# to a reference to an array of the other values captured by $RE.
+sub get_bench_results {
+    my ($re, @params) = @_;
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output)
+      if grep (/^Executing '/, @output);
+
+    my (@found, %results);
+    local ($_);
+    foreach (@output) {
+	my ($param, @values) = /$re/ or next;
+	push (@found, $param);
+	$results{$param} = [@values];
+    }
+    fail "Expected results for " . join (', ', @params) . ", got "
+      . (@found ? join (', ', @found) : "none") . ".\n"
+      if join ("\n", @found) ne join ("\n", @params);
+    return %results;
+}
+
 sub compare_output {
     my ($run) = shift @_;
     my ($expected) = pop @_;
@@ -0,0 +1,75 @@
+/* Timer microbenchmark: measures how many CPU cycles the
+   scheduler's part of a timer interrupt takes with 10, 100 and
+   1000 sleeping threads, due over the next few hundred ticks.
+   The cost should not depend on the number of sleepers. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define MAX_THREAD_CNT 1000
+#define SETTLE_TICKS 10
+#define BENCH_TICKS 50
+
+static thread_func sleeper;
+
+static int64_t wake_ticks[MAX_THREAD_CNT];
+static struct semaphore done;
+
+static void
+run_bench (int thread_cnt)
+{
+  uint64_t cycles;
+  int64_t start;
+  int i;
+
+  /* All wake up after the measurement, some of them more than
+     256 ticks away. */
+  start = timer_ticks ();
+  for (i = 0; i < thread_cnt; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "sleeper %d", i);
+      wake_ticks[i] = start + SETTLE_TICKS + BENCH_TICKS + 20 + i % 300;
+      if (thread_create (name, PRI_DEFAULT, sleeper, &wake_ticks[i])
+          == TID_ERROR)
+        fail ("creating thread %d of %d failed", i, thread_cnt);
+    }
+
+  /* Let them all go to sleep, then measure. */
+  timer_sleep (SETTLE_TICKS);
+  start = timer_ticks ();
+  cycles = thread_tick_cycles ();
+  timer_sleep (BENCH_TICKS);
+  cycles = (thread_tick_cycles () - cycles) / timer_elapsed (start);
+
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&done);
+  msg ("%d sleepers: %llu cycles per timer tick", thread_cnt, cycles);
+}
+
+void
+test_alarm_bench (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  thread_set_priority (PRI_DEFAULT + 1);
+  run_bench (10);
+  run_bench (100);
+  run_bench (1000);
+  thread_set_priority (PRI_DEFAULT);
+}
+
+static void
+sleeper (void *wake_tick_)
+{
+  int64_t *wake_tick = wake_tick_;
+
+  timer_sleep (*wake_tick - timer_ticks ());
+  sema_up (&done);
+}
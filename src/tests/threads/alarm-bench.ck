@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+my (%cycles) = get_bench_results
+  (qr/^\(alarm-bench\) (\d+) sleepers: (\d+) cycles per timer tick$/,
+   10, 100, 1000);
+
+# None of the sleepers is due during the measurement, so a timer
+# tick should not cost much more with 100 times as many of them.
+foreach my $thread_cnt (10, 100, 1000) {
+    fail "No timer tick cost with $thread_cnt sleepers.\n"
+      if $cycles{$thread_cnt}[0] == 0;
+}
+fail "$cycles{1000}[0] cycles per timer tick with 1000 sleepers "
+  . "is more than 4 times $cycles{10}[0] with 10 sleepers.\n"
+  if $cycles{1000}[0] > 4 * $cycles{10}[0];
+pass;
@@ -0,0 +1,43 @@
+/* Sleeps 50 us, 500 us and 5 ms, 20 times each, with
+   timer_usleep(), which blocks on a high-resolution timer, and
+   reports how late the thread woke up, according to the TSC. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 20
+
+static void
+measure (int64_t us)
+{
+  int64_t total = 0, max = 0;
+  int i;
+
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      int64_t start = timer_ns ();
+      int64_t late;
+
+      timer_usleep (us);
+      late = (timer_ns () - start) / 1000 - us;
+      if (late < -us / 10)
+        fail ("%lld us sleep woke up after %lld us",
+              (long long) us, (long long) (us + late));
+      total += late;
+      if (late > max)
+        max = late;
+    }
+  msg ("%lld us sleeps: %lld us late on average, %lld us at most",
+       (long long) us, (long long) (total / SLEEP_CNT), (long long) max);
+}
+
+void
+test_alarm_hires (void)
+{
+  measure (50);
+  measure (500);
+  measure (5000);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+my (%late) = get_bench_results
+  (qr/^\(alarm-hires\) (\d+) us sleeps: (-?\d+) us late on average, (-?\d+) us at most$/,
+   50, 500, 5000);
+
+# A sleep on a high-resolution timer should end soon after it is
+# due.  Rounding it up to the next 10 ms timer tick would make it
+# about 5 ms late or more on average.
+foreach my $length (50, 500, 5000) {
+    my ($average, $max) = @{$late{$length}};
+    fail "$length us sleeps were $max us late at most, "
+      . "less than the average of $average us.\n"
+      if $max < $average;
+    fail "$length us sleeps were $average us late on average, "
+      . "at least half a timer tick.\n"
+      if $average >= 5000;
+}
+pass;
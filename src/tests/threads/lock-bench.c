@@ -0,0 +1,137 @@
+/* Lock contention microbenchmark: 8 threads at the same priority
+   enter a short critical section over and over, and are now and
+   then preempted inside it.  Measures how many times per second
+   they get in with lock_acquire(), lock_acquire_adaptive(), a
+   readers-writer lock taken for reading only, and one taken for
+   writing one time in 8. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 8
+#define BENCH_TICKS 50
+
+enum mode
+  {
+    MODE_LOCK,                  /* lock_acquire(). */
+    MODE_ADAPTIVE,              /* lock_acquire_adaptive(). */
+    MODE_READ,                  /* rwlock, for reading. */
+    MODE_MIXED                  /* rwlock, for writing 1 time in 8. */
+  };
+
+static const char *mode_names[] =
+  {"lock", "adaptive lock", "rwlock read", "rwlock 1/8 write"};
+
+static thread_func contend_thread;
+
+static enum mode mode;
+static volatile bool stop;
+static long long enter_cnts[THREAD_CNT];
+static struct lock lock;
+static struct rwlock rwlock;
+static struct semaphore done;
+
+static void
+run_bench (enum mode mode_)
+{
+  long long total = 0;
+  int64_t start;
+  int i;
+
+  mode = mode_;
+  stop = false;
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "contend %d", i);
+      enter_cnts[i] = 0;
+      if (thread_create (name, PRI_DEFAULT, contend_thread, &enter_cnts[i])
+          == TID_ERROR)
+        fail ("creating thread %d failed", i);
+    }
+
+  /* The threads run while we sleep, at a lower priority. */
+  start = timer_ticks ();
+  timer_sleep (BENCH_TICKS);
+  stop = true;
+  for (i = 0; i < THREAD_CNT; i++)
+    total += enter_cnts[i];
+  total = total * TIMER_FREQ / timer_elapsed (start);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+  msg ("%s: %lld acquisitions per second", mode_names[mode], total);
+}
+
+void
+test_lock_bench (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&lock);
+  rwlock_init (&rwlock);
+  sema_init (&done, 0);
+  thread_set_priority (PRI_DEFAULT + 1);
+  run_bench (MODE_LOCK);
+  run_bench (MODE_ADAPTIVE);
+  run_bench (MODE_READ);
+  run_bench (MODE_MIXED);
+  thread_set_priority (PRI_DEFAULT);
+}
+
+/* Critical section, which is preempted one time in 16. */
+static void
+critical_section (long long cnt)
+{
+  int i;
+
+  for (i = 0; i < 100; i++)
+    barrier ();
+  if (cnt % 16 == 0)
+    thread_yield ();
+}
+
+static void
+contend_thread (void *cnt_)
+{
+  long long *cnt = cnt_;
+
+  while (!stop)
+    {
+      ++*cnt;
+      switch (mode)
+        {
+        case MODE_LOCK:
+        case MODE_ADAPTIVE:
+          if (mode == MODE_LOCK)
+            lock_acquire (&lock);
+          else
+            lock_acquire_adaptive (&lock);
+          critical_section (*cnt);
+          lock_release (&lock);
+          break;
+
+        case MODE_READ:
+        case MODE_MIXED:
+          if (mode == MODE_MIXED && *cnt % 8 == 0)
+            {
+              rwlock_acquire_write (&rwlock);
+              critical_section (*cnt);
+              rwlock_release_write (&rwlock);
+            }
+          else
+            {
+              rwlock_acquire_read (&rwlock);
+              critical_section (*cnt);
+              rwlock_release_read (&rwlock);
+            }
+          break;
+        }
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+my (@modes) = ("lock", "adaptive lock", "rwlock read", "rwlock 1/8 write");
+my (%rate) = get_bench_results
+  (qr/^\(lock-bench\) ([\w\s\/]+): (\d+) acquisitions per second$/, @modes);
+
+# A reader preempted inside the critical section does not keep the
+# other readers out, as a lock holder does, so readers should get
+# in at least as often.
+foreach my $mode (@modes) {
+    fail "No acquisitions with $mode.\n" if $rate{$mode}[0] == 0;
+}
+fail "$rate{'rwlock read'}[0] acquisitions per second with rwlock read "
+  . "is less than $rate{'lock'}[0] with lock.\n"
+  if $rate{'rwlock read'}[0] < $rate{'lock'}[0];
+pass;
@@ -0,0 +1,80 @@
+/* Scheduler microbenchmark: measures how many context switches
+   per second the scheduler makes with 2, 16, 64 and 256 threads
+   that are all ready to run, each of which does nothing but
+   yield the CPU to the next one.  The rate should not depend
+   on the number of threads. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define MAX_THREAD_CNT 256
+#define BENCH_TICKS 50
+
+static thread_func yield_thread;
+
+static volatile bool stop;
+static long long yield_cnts[MAX_THREAD_CNT];
+static struct semaphore done;
+
+static void
+run_bench (int thread_cnt)
+{
+  long long total = 0;
+  int64_t start;
+  int i;
+
+  stop = false;
+  for (i = 0; i < thread_cnt; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "yield %d", i);
+      yield_cnts[i] = 0;
+      if (thread_create (name, PRI_DEFAULT, yield_thread, &yield_cnts[i])
+          == TID_ERROR)
+        fail ("creating thread %d of %d failed", i, thread_cnt);
+    }
+
+  /* The threads run while we sleep, at a lower priority. */
+  start = timer_ticks ();
+  timer_sleep (BENCH_TICKS);
+  stop = true;
+  for (i = 0; i < thread_cnt; i++)
+    total += yield_cnts[i];
+  total = total * TIMER_FREQ / timer_elapsed (start);
+
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&done);
+  msg ("%d threads: %lld context switches per second", thread_cnt, total);
+}
+
+void
+test_sched_bench (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  thread_set_priority (PRI_DEFAULT + 1);
+  run_bench (2);
+  run_bench (16);
+  run_bench (64);
+  run_bench (256);
+  thread_set_priority (PRI_DEFAULT);
+}
+
+static void
+yield_thread (void *cnt_)
+{
+  long long *cnt = cnt_;
+
+  while (!stop)
+    {
+      ++*cnt;
+      thread_yield ();
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+my (%rate) = get_bench_results
+  (qr/^\(sched-bench\) (\d+) threads: (\d+) context switches per second$/,
+   2, 16, 64, 256);
+
+# Picking the next thread should not take longer with more
+# threads ready to run, so the rate should not fall by much.
+foreach my $thread_cnt (2, 16, 64, 256) {
+    fail "No context switches with $thread_cnt threads.\n"
+      if $rate{$thread_cnt}[0] == 0;
+}
+fail "$rate{256}[0] context switches per second with 256 threads "
+  . "is less than half of $rate{2}[0] with 2 threads.\n"
+  if $rate{256}[0] * 2 < $rate{2}[0];
+pass;
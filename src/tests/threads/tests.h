@@ -23,7 +23,12 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_sched_bench;
+extern test_func test_lock_bench;
+extern test_func test_alarm_bench;
+extern test_func test_alarm_hires;
 extern test_func test_mlfqs_load_1;
+extern test_func test_mlfqs_load_20;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
 extern test_func test_mlfqs_recent_1;
@@ -0,0 +1,33 @@
+/* Child process of page-cow.
+   Checks that an initialized 16 kB array holds its initial
+   contents, overwrites it, and checks that the new contents
+   stuck. */
+
+#include <stdlib.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+const char *test_name = "child-cow";
+
+#define SIZE (16 * 1024)
+static char data[SIZE] = { [0 ... SIZE - 1] = 'x' };
+
+int
+main (int argc, char *argv[])
+{
+  int id = atoi (argv[argc - 1]);
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (data[i] != 'x')
+      fail ("byte %zu is %d, not 'x'", i, data[i]);
+
+  for (i = 0; i < SIZE; i++)
+    data[i] = 'a' + id;
+
+  for (i = 0; i < SIZE; i++)
+    if (data[i] != 'a' + id)
+      fail ("byte %zu is %d, not %d", i, data[i], 'a' + id);
+
+  return id;
+}
@@ -0,0 +1,28 @@
+/* Runs 4 child-cow processes at once, which share the pages of
+   their executable until they write to them, and checks that
+   each saw its own writes only. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      char cmd_line[32];
+      snprintf (cmd_line, sizeof cmd_line, "child-cow %d", i);
+      CHECK ((children[i] = exec (cmd_line)) != -1,
+             "exec \"child-cow %d\"", i);
+    }
+
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == i, "wait for child %d", i);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-cow) begin
+(page-cow) exec "child-cow 0"
+(page-cow) exec "child-cow 1"
+(page-cow) exec "child-cow 2"
+(page-cow) exec "child-cow 3"
+(page-cow) wait for child 0
+(page-cow) wait for child 1
+(page-cow) wait for child 2
+(page-cow) wait for child 3
+(page-cow) end
+EOF
+pass;
@@ -0,0 +1,5 @@
+/* page-linear with fault-around disabled (-fa=0), so that every
+   page brought back in takes a fault of its own.  The data must
+   still verify, and no page may be brought in around a fault. */
+
+#include "tests/vm/page-linear.c"
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-linear-fa-off) begin
+(page-linear-fa-off) initialize
+(page-linear-fa-off) read pass
+(page-linear-fa-off) read/modify/write pass one
+(page-linear-fa-off) read/modify/write pass two
+(page-linear-fa-off) read pass
+(page-linear-fa-off) end
+EOF
+
+my ($around) = get_stats (qr/^Fault-around: (\d+) pages brought in/,
+			  read_text_file ("$test.output"));
+fail "$around pages brought in around faults with -fa=0.\n" if $around != 0;
+pass;
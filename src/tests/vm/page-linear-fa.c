@@ -0,0 +1,5 @@
+/* page-linear with fault-around on, as by default.  The passes
+   over swapped-out memory are sequential, so some pages must be
+   brought in around a fault. */
+
+#include "tests/vm/page-linear.c"
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-linear-fa) begin
+(page-linear-fa) initialize
+(page-linear-fa) read pass
+(page-linear-fa) read/modify/write pass one
+(page-linear-fa) read/modify/write pass two
+(page-linear-fa) read pass
+(page-linear-fa) end
+EOF
+
+# The passes over swapped-out memory are sequential, which the
+# fault-around must pick up.
+my ($around) = get_stats (qr/^Fault-around: (\d+) pages brought in/,
+			  read_text_file ("$test.output"));
+fail "No page was brought in around a fault.\n" if $around == 0;
+pass;
@@ -0,0 +1,5 @@
+/* page-merge-par with the two-handed clock eviction policy
+   (-evict=clock2), which must sort and merge the data just as
+   well. */
+
+#include "tests/vm/page-merge-par.c"
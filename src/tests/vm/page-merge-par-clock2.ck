@@ -0,0 +1,34 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-merge-par-clock2) begin
+(page-merge-par-clock2) init
+(page-merge-par-clock2) sort chunk 0
+(page-merge-par-clock2) sort chunk 1
+(page-merge-par-clock2) sort chunk 2
+(page-merge-par-clock2) sort chunk 3
+(page-merge-par-clock2) sort chunk 4
+(page-merge-par-clock2) sort chunk 5
+(page-merge-par-clock2) sort chunk 6
+(page-merge-par-clock2) sort chunk 7
+(page-merge-par-clock2) wait for child 0
+(page-merge-par-clock2) wait for child 1
+(page-merge-par-clock2) wait for child 2
+(page-merge-par-clock2) wait for child 3
+(page-merge-par-clock2) wait for child 4
+(page-merge-par-clock2) wait for child 5
+(page-merge-par-clock2) wait for child 6
+(page-merge-par-clock2) wait for child 7
+(page-merge-par-clock2) merge
+(page-merge-par-clock2) verify
+(page-merge-par-clock2) success, buf_idx=1,048,576
+(page-merge-par-clock2) end
+EOF
+
+my ($policy) = get_stats (qr/^Frames: .* (\w+) policy\)$/,
+			  read_text_file ("$test.output"));
+fail "Evicted with the $policy policy, not clock2.\n" if $policy ne "clock2";
+pass;
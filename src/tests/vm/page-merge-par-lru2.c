@@ -0,0 +1,5 @@
+/* page-merge-par with the approximated LRU-2 eviction policy
+   (-evict=lru2), which must sort and merge the data just as
+   well. */
+
+#include "tests/vm/page-merge-par.c"
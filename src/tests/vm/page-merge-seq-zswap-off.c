@@ -0,0 +1,6 @@
+/* page-merge-seq with the compressed swap disabled (-zswap=0), so
+   that every evicted page is written to the swap disk.  The data
+   must still verify, and more pages must go to the swap disk than
+   in page-merge-seq. */
+
+#include "tests/vm/page-merge-seq.c"
@@ -0,0 +1,35 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::zswap;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-merge-seq-zswap-off) begin
+(page-merge-seq-zswap-off) init
+(page-merge-seq-zswap-off) sort chunk 0
+(page-merge-seq-zswap-off) sort chunk 1
+(page-merge-seq-zswap-off) sort chunk 2
+(page-merge-seq-zswap-off) sort chunk 3
+(page-merge-seq-zswap-off) sort chunk 4
+(page-merge-seq-zswap-off) sort chunk 5
+(page-merge-seq-zswap-off) sort chunk 6
+(page-merge-seq-zswap-off) sort chunk 7
+(page-merge-seq-zswap-off) sort chunk 8
+(page-merge-seq-zswap-off) sort chunk 9
+(page-merge-seq-zswap-off) sort chunk 10
+(page-merge-seq-zswap-off) sort chunk 11
+(page-merge-seq-zswap-off) sort chunk 12
+(page-merge-seq-zswap-off) sort chunk 13
+(page-merge-seq-zswap-off) sort chunk 14
+(page-merge-seq-zswap-off) sort chunk 15
+(page-merge-seq-zswap-off) merge
+(page-merge-seq-zswap-off) verify
+(page-merge-seq-zswap-off) success, buf_idx=1,032,192
+(page-merge-seq-zswap-off) end
+EOF
+
+# The sorted chunks compress well, so page-merge-seq keeps some of
+# them in the compressed swap instead of writing them to the disk.
+check_zswap_off ("tests/vm/page-merge-seq");
+pass;
@@ -0,0 +1,6 @@
+/* Runs 4 child-linear processes at once, which together need
+   more memory than there is, with the page-out daemon disabled
+   (-po=0), so that every eviction happens in a page fault.  Each
+   child verifies its data. */
+
+#include "tests/vm/page-pageout.inc"
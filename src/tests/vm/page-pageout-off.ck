@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-pageout-off) begin
+(page-pageout-off) exec "child-linear"
+(page-pageout-off) exec "child-linear"
+(page-pageout-off) exec "child-linear"
+(page-pageout-off) exec "child-linear"
+(page-pageout-off) wait for child 0
+(page-pageout-off) wait for child 1
+(page-pageout-off) wait for child 2
+(page-pageout-off) wait for child 3
+(page-pageout-off) end
+EOF
+
+my ($paged_out) = get_stats (qr/^Frames: \d+ allocated, (\d+) paged out/,
+			     read_text_file ("$test.output"));
+fail "$paged_out frames paged out with -po=0.\n" if $paged_out != 0;
+pass;
@@ -0,0 +1,6 @@
+/* Runs 4 child-linear processes at once, which together need
+   more memory than there is, with the page-out daemon keeping
+   free frames around.  Each child verifies its data, and the
+   daemon must page out some of it. */
+
+#include "tests/vm/page-pageout.inc"
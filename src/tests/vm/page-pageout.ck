@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-pageout) begin
+(page-pageout) exec "child-linear"
+(page-pageout) exec "child-linear"
+(page-pageout) exec "child-linear"
+(page-pageout) exec "child-linear"
+(page-pageout) wait for child 0
+(page-pageout) wait for child 1
+(page-pageout) wait for child 2
+(page-pageout) wait for child 3
+(page-pageout) end
+EOF
+
+my ($paged_out) = get_stats (qr/^Frames: \d+ allocated, (\d+) paged out/,
+			     read_text_file ("$test.output"));
+fail "The page-out daemon paged out no frame.\n" if $paged_out == 0;
+pass;
@@ -0,0 +1,6 @@
+/* page-shuffle with user memory limited to 40 pages (-ul=40), less
+   than its buffer and code take, so that pages are evicted: the
+   first ones while the buffer is initialized, with a pattern that
+   compresses well.  The data must still verify. */
+
+#include "tests/vm/page-shuffle.c"
@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::page_shuffle;
+check_page_shuffle ("page-shuffle-swap");
+pass;
@@ -0,0 +1,6 @@
+/* page-shuffle-swap with the compressed swap disabled (-zswap=0), so
+   that every evicted page is written to the swap disk.  The data
+   must still verify, and more pages must go to the swap disk than
+   in page-shuffle-swap. */
+
+#include "tests/vm/page-shuffle.c"
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::vm::page_shuffle;
+use tests::vm::zswap;
+check_page_shuffle ("page-shuffle-zswap-off");
+
+# The pages evicted while the buffer is initialized compress well, so
+# page-shuffle-swap keeps them in the compressed swap instead of
+# writing them to the disk.
+check_zswap_off ("tests/vm/page-shuffle-swap");
+pass;
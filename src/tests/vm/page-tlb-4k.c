@@ -0,0 +1,4 @@
+/* page-tlb without large pages (no -lp), so that the range is
+   mapped with 1,024 pages of 4 kB, and no large page at all. */
+
+#include "tests/vm/page-tlb.c"
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-tlb-4k) begin
+(page-tlb-4k) touch 1024 pages 256 times
+(page-tlb-4k) check
+(page-tlb-4k) end
+EOF
+
+my ($large) = get_stats (qr/^Large pages: (\d+) mapped/,
+			 read_text_file ("$test.output"));
+fail "$large large pages mapped without -lp.\n" if $large != 0;
+pass;
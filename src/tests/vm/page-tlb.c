@@ -0,0 +1,41 @@
+/* TLB benchmark: touches the 1,024 pages of a 4 MB aligned
+   range of a large zero-filled array over and over, in an order
+   that jumps around it, so that every access misses a TLB of 4
+   kB pages.  Run with large pages (-lp), the range takes a
+   single TLB entry: it must be mapped with a large page, and
+   read back intact. */
+
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LARGE (4 * 1024 * 1024)
+#define PAGE 4096
+#define PAGE_CNT (LARGE / PAGE)
+#define ROUNDS 256
+#define STRIDE 97               /* Odd, so all pages are visited. */
+
+/* Twice the size of a large page holds an aligned one. */
+static char buf[2 * LARGE];
+
+void
+test_main (void)
+{
+  char *range = (char *) (((uintptr_t) buf + LARGE - 1) & ~(LARGE - 1));
+  size_t round, i;
+
+  msg ("touch %d pages %d times", PAGE_CNT, ROUNDS);
+  for (round = 0; round < ROUNDS; round++)
+    for (i = 0; i < PAGE_CNT; i++)
+      range[(i * STRIDE) % PAGE_CNT * PAGE + round]++;
+
+  msg ("check");
+  for (i = 0; i < PAGE_CNT; i++)
+    for (round = 0; round < PAGE; round++)
+      {
+        char expected = round < ROUNDS;
+        if (range[i * PAGE + round] != expected)
+          fail ("byte %zu of page %zu is %d, not %d",
+                round, i, range[i * PAGE + round], expected);
+      }
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-tlb) begin
+(page-tlb) touch 1024 pages 256 times
+(page-tlb) check
+(page-tlb) end
+EOF
+
+my ($large) = get_stats (qr/^Large pages: (\d+) mapped/,
+			 read_text_file ("$test.output"));
+fail "No large page mapped with -lp.\n" if $large == 0;
+pass;
@@ -0,0 +1,36 @@
+/* Reads every page of a 2 MB zero-filled array, which maps them
+   all to the shared zero frame, then writes to every eighth page
+   and verifies that the writes stuck and that the other pages
+   still read as zeros. */
+
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+#define PAGE 4096
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  msg ("read pass");
+  for (i = 0; i < SIZE; i += PAGE)
+    if (buf[i] != 0)
+      fail ("byte %zu != 0", i);
+
+  msg ("write every eighth page");
+  for (i = 0; i < SIZE; i += 8 * PAGE)
+    memset (buf + i, (char) (i / PAGE), PAGE);
+
+  msg ("read pass");
+  for (i = 0; i < SIZE; i++)
+    {
+      char expected = (i / PAGE) % 8 == 0 ? (char) (i / PAGE) : 0;
+      if (buf[i] != expected)
+        fail ("byte %zu is %d, not %d", i, buf[i], expected);
+    }
+}
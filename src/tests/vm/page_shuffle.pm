@@ -0,0 +1,52 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::cksum;
+use tests::lib;
+
+# check_page_shuffle ($NAME)
+#
+# Checks the output of page-shuffle, run as $NAME.
+sub check_page_shuffle {
+    my ($name) = @_;
+
+    my ($init, @shuffle);
+    if (1) {
+	# Use precalculated values.
+	$init = 3115322833;
+	@shuffle = (1691062564, 1973575879, 1647619479, 96566261, 3885786467,
+		    3022003332, 3614934266, 2704001777, 735775156, 1864109763);
+    } else {
+	# Recalculate values.
+	my ($buf) = "";
+	for my $i (0...128 * 1024 - 1) {
+	    $buf .= chr (($i * 257) & 0xff);
+	}
+	$init = cksum ($buf);
+
+	random_init (0);
+	for my $i (1...10) {
+	    $buf = shuffle ($buf, length ($buf), 1);
+	    push (@shuffle, cksum ($buf));
+	}
+    }
+
+    check_expected (IGNORE_EXIT_CODES => 1, [<<EOF]);
+($name) begin
+($name) init: cksum=$init
+($name) shuffle 0: cksum=$shuffle[0]
+($name) shuffle 1: cksum=$shuffle[1]
+($name) shuffle 2: cksum=$shuffle[2]
+($name) shuffle 3: cksum=$shuffle[3]
+($name) shuffle 4: cksum=$shuffle[4]
+($name) shuffle 5: cksum=$shuffle[5]
+($name) shuffle 6: cksum=$shuffle[6]
+($name) shuffle 7: cksum=$shuffle[7]
+($name) shuffle 8: cksum=$shuffle[8]
+($name) shuffle 9: cksum=$shuffle[9]
+($name) end
+EOF
+}
+
+1;
@@ -0,0 +1,32 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# Returns the number of pages that $TEST wrote to the swap disk.
+sub get_swap_disk_pages {
+    my ($test) = @_;
+    my ($pages) = get_stats (qr/^Swap: .* (\d+) pages out in/,
+			     read_text_file ("$test.output"));
+    return $pages;
+}
+
+# check_zswap_off ($POOL_TEST)
+#
+# For a test run with -zswap=0: fails if the compressed swap was
+# set up anyway, or unless the test wrote more pages to the swap
+# disk than $POOL_TEST, the same program run with the compressed
+# swap, i.e. unless the pool avoided some disk writes.
+sub check_zswap_off {
+    my ($pool_test) = @_;
+    our ($test);
+
+    fail "Compressed swap set up with -zswap=0.\n"
+      if grep (/^Compressed swap:/, read_text_file ("$test.output"));
+    my ($off) = get_swap_disk_pages ($test);
+    my ($on) = get_swap_disk_pages ($pool_test);
+    fail "$off pages written to the swap disk without the compressed "
+      . "swap, no more than $on with it.\n" if $off <= $on;
+}
+
+1;
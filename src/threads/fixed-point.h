@@ -0,0 +1,50 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* Signed 17.14 fixed-point numbers, as used by the advanced
+   scheduler: the 14 low bits of an int hold the fraction, the
+   other 17 the integer part and the sign, so the largest number
+   is a little more than 131,071.
+
+   Products are computed in 64 bits, so that the multiplication
+   of two fixed-point numbers does not overflow before it is
+   scaled back.  See the "4.4BSD Scheduler" appendix of the
+   Pintos reference guide. */
+typedef int fixed_t;
+
+#define FP_SHIFT 14                     /* Fraction bits. */
+#define FP_ONE (1 << FP_SHIFT)          /* 1 in fixed point. */
+
+/* Returns N as a fixed-point number. */
+static inline fixed_t fp_from_int (int n) {
+  return n * FP_ONE;
+}
+
+/* Returns X rounded toward zero. */
+static inline int fp_to_int (fixed_t x) {
+  return x / FP_ONE;
+}
+
+/* Returns X rounded to the nearest integer. */
+static inline int fp_round (fixed_t x) {
+  return x >= 0 ? (x + FP_ONE / 2) / FP_ONE : (x - FP_ONE / 2) / FP_ONE;
+}
+
+/* Returns X + N, for an integer N. */
+static inline fixed_t fp_add_int (fixed_t x, int n) {
+  return x + n * FP_ONE;
+}
+
+/* Returns X * Y. */
+static inline fixed_t fp_mul (fixed_t x, fixed_t y) {
+  return ((int64_t) x) * y / FP_ONE;
+}
+
+/* Returns X / Y. */
+static inline fixed_t fp_div (fixed_t x, fixed_t y) {
+  return ((int64_t) x) * FP_ONE / y;
+}
+
+#endif /* threads/fixed-point.h */
@@ -33,18 +33,31 @@
 #endif
 #ifdef VM
 #include "vm/frame.h"
+#include "vm/page.h"
 #include "vm/swap.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/inode.h"
 #endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
 
+/* True if the CPU supports 4 MB pages, which are then enabled. */
+bool init_large_pages;
+
+/* CR4 and CPUID bits for 4 MB pages (Page Size Extension).  See
+   [IA32-v3a] 2.5 "Control Registers" and [IA32-v2a] "CPUID--CPU
+   Identification". */
+#define CR4_PSE 0x00000010      /* Page Size Extension enable. */
+#define CPUID_PSE 0x00000008    /* CPUID.1:EDX, PSE supported. */
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -63,6 +76,7 @@ static size_t user_page_limit = SIZE_MAX;
 
 static void bss_init (void);
 static void paging_init (void);
+static bool cpu_has_pse (void);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
@@ -106,6 +120,7 @@ main (void)
 #ifdef VM
   /* Initialize Virtual memory system. (Project 3) */
   vm_frame_init();
+  vm_page_init();
 #endif
 
   /* Segmentation. */
@@ -137,6 +152,8 @@ main (void)
 #endif
 #ifdef VM
   vm_swap_init ();
+  vm_zswap_init ();
+  vm_frame_init_pageout ();
 #endif
 
   printf ("Boot complete.\n");
@@ -173,6 +190,7 @@ paging_init (void)
   size_t page;
   extern char _start, _end_kernel_text;
 
+  init_large_pages = cpu_has_pse ();
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++)
@@ -183,6 +201,21 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      /* Map each whole 4 MB of kernel data with a single large
+         page, which takes one TLB entry instead of 1,024.  Not
+         the kernel text, which is read-only, nor the user pool,
+         whose pages need accessed and dirty bits of their own
+         (see vm/frame.c). */
+      if (init_large_pages && pte_idx == 0
+          && page + LPGSIZE / PGSIZE <= init_ram_pages
+          && !(vaddr < &_end_kernel_text && &_start < vaddr + LPGSIZE)
+          && !palloc_overlaps_user_pool (vaddr, LPGSIZE / PGSIZE))
+        {
+          pd[pde_idx] = pde_create_large (vaddr, true, false);
+          page += LPGSIZE / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
@@ -192,6 +225,15 @@ paging_init (void)
       pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
     }
 
+  /* Large pages in the page directory are only understood with
+     CR4.PSE set. */
+  if (init_large_pages)
+    {
+      uint32_t cr4;
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4 | CR4_PSE));
+    }
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
@@ -200,6 +242,16 @@ paging_init (void)
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
 }
 
+/* Returns true if the CPU supports 4 MB pages. */
+static bool
+cpu_has_pse (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+
+  asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  return (edx & CPUID_PSE) != 0;
+}
+
 /* Breaks the kernel command line into words and returns them as
    an argv-like array. */
 static char **
@@ -259,15 +311,64 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-fsformat"))
+        {
+          if (value != NULL && !strcmp (value, "extent"))
+            inode_format = INODE_FORMAT_EXTENT;
+          else if (value != NULL && !strcmp (value, "indirect"))
+            inode_format = INODE_FORMAT_INDIRECT;
+          else
+            PANIC ("unknown file system format `%s'", value);
+        }
+      else if (!strcmp (name, "-ra"))
+        buffer_cache_readahead_window = atoi (value);
+      else if (!strcmp (name, "-wb"))
+        buffer_cache_writebehind_interval = atoi (value);
+      else if (!strcmp (name, "-ide"))
+        {
+          if (value != NULL && !strcmp (value, "pio"))
+            ide_set_xfer_mode (IDE_XFER_PIO);
+          else if (value != NULL && !strcmp (value, "multiple"))
+            ide_set_xfer_mode (IDE_XFER_PIO_MULTIPLE);
+          else if (value != NULL && !strcmp (value, "dma"))
+            ide_set_xfer_mode (IDE_XFER_DMA);
+          else
+            PANIC ("unknown IDE transfer mode `%s'", value);
+        }
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
+      else if (!strcmp (name, "-po"))
+        vm_frame_low_water = atoi (value);
+      else if (!strcmp (name, "-evict"))
+        {
+          if (value != NULL && !strcmp (value, "clock"))
+            vm_frame_policy = VM_EVICT_CLOCK;
+          else if (value != NULL && !strcmp (value, "clock2"))
+            vm_frame_policy = VM_EVICT_CLOCK2;
+          else if (value != NULL && !strcmp (value, "lru2"))
+            vm_frame_policy = VM_EVICT_LRU2;
+          else
+            PANIC ("unknown eviction policy `%s'", value);
+        }
+      else if (!strcmp (name, "-zswap"))
+        vm_zswap_pages = atoi (value);
+      else if (!strcmp (name, "-fa"))
+        {
+          vm_fault_around_max = atoi (value);
+          if (vm_fault_around_max > VM_FAULT_AROUND_MAX)
+            vm_fault_around_max = VM_FAULT_AROUND_MAX;
+        }
+      else if (!strcmp (name, "-lp"))
+        vm_large_pages = true;
 #endif
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -327,6 +428,11 @@ run_actions (char **argv)
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+      {"blockbench", 2, fsutil_blockbench},
+      {"cachebench", 1, buffer_cache_bench},
+#endif
+#ifdef VM
+      {"swapbench", 1, vm_swap_bench},
 #endif
       {NULL, 0, NULL},
     };
@@ -376,6 +482,11 @@ usage (void)
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  extract            Untar from scratch device into file system.\n"
           "  append FILE        Append FILE to tar file on scratch device.\n"
+          "  blockbench BDEV    Measure BDEV throughput in each IDE mode.\n"
+          "  cachebench         Measure buffer cache hits from 1-16 threads.\n"
+#endif
+#ifdef VM
+          "  swapbench          Measure swap-out rate, empty and 90%% full.\n"
 #endif
           "\nOptions:\n"
           "  -h                 Print this help message and power off.\n"
@@ -385,12 +496,22 @@ usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -fsformat=FORMAT   Format with FORMAT (extent or indirect) inodes.\n"
+          "  -ra=SECTORS        Read SECTORS ahead of sequential reads (0=off).\n"
+          "  -wb=TICKS          Write back dirty sectors every TICKS (0=off).\n"
+          "  -ide=MODE          Prefer IDE transfer MODE (pio, multiple, dma).\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+          "  -po=PAGES          Page out to keep PAGES user pages free (0=off).\n"
+          "  -evict=POLICY      Evict pages by POLICY (clock, clock2, lru2).\n"
+          "  -fa=PAGES          Bring in up to PAGES pages around a fault (0=off).\n"
+          "  -zswap=PAGES       Keep swapped pages compressed in PAGES pages (0=off).\n"
+          "  -lp                Map aligned 4 MB of user memory with large pages.\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -tickless          Stop the periodic timer interrupt while idle.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
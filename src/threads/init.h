@@ -9,4 +9,7 @@
 /* Page directory with kernel mappings only. */
 extern uint32_t *init_page_dir;
 
+/* True if 4 MB pages are supported and enabled. */
+extern bool init_large_pages;
+
 #endif /* threads/init.h */
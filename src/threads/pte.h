@@ -66,6 +66,16 @@ static inline uintptr_t pd_no (const void *va) {
 #define PTE_U 0x4               /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80             /* 1=4 MB page, 0=page table (PDEs only). */
+
+/* A PDE with PTE_PS set maps a 4 MB "large page" directly,
+   instead of pointing to a page table.  Its flags have the same
+   meaning as in a PTE, including PTE_D, and bits 22:31 of its
+   address are the physical address of the page.  The CPU only
+   honors PTE_PS with CR4.PSE set.  See [IA32-v3a] 3.7.3
+   "Mixing 4-KByte and 4-MByte Pages". */
+#define LPGSIZE PTSPAN          /* Bytes in a large page. */
+#define PDE_LADDR 0xffc00000    /* Address bits of a large page PDE. */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create (uint32_t *pt) {
@@ -77,9 +87,33 @@ static inline uint32_t pde_create (uint32_t *pt) {
    PDE, which must "present", points to. */
 static inline uint32_t *pde_get_pt (uint32_t pde) {
   ASSERT (pde & PTE_P);
+  ASSERT (!(pde & PTE_PS));
   return ptov (pde & PTE_ADDR);
 }
 
+/* Returns true if PDE, which must be present, maps a large page
+   rather than pointing to a page table. */
+static inline bool pde_is_large (uint32_t pde) {
+  ASSERT (pde & PTE_P);
+  return (pde & PTE_PS) != 0;
+}
+
+/* Returns a PDE that maps the large page at PAGE, which must be
+   aligned on a LPGSIZE boundary, with the flags of a PTE created
+   by pte_create_kernel() or pte_create_user(), as USER says. */
+static inline uint32_t pde_create_large (void *page, bool writable,
+                                         bool user) {
+  ASSERT (((uintptr_t) page & (LPGSIZE - 1)) == 0);
+  return vtop (page) | PTE_PS | PTE_P | (writable ? PTE_W : 0)
+         | (user ? PTE_U : 0);
+}
+
+/* Returns a pointer to the large page that PDE maps. */
+static inline void *pde_get_large (uint32_t pde) {
+  ASSERT (pde_is_large (pde));
+  return ptov (pde & PDE_LADDR);
+}
+
 /* Returns a PTE that points to PAGE.
    The PTE's page is readable.
    If WRITABLE is true then it will be writable as well.
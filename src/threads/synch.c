@@ -32,6 +32,10 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Number of times lock_acquire_adaptive() yields to the holder
+   of a lock before blocking on it. */
+#define LOCK_SPIN_MAX 8
+
 static bool comparator_greater_thread_priority(const struct list_elem*, const struct list_elem*, void *);
 static bool comparator_greater_lock_priority(const struct list_elem*, const struct list_elem*, void *);
 static bool comparator_greater_sema_priority(const struct list_elem*, const struct list_elem*, void *);
@@ -262,10 +266,56 @@ lock_try_acquire (struct lock *lock)
   if (success) {
     struct thread *t_current = thread_current();
     lock->holder = t_current;
+    // as in lock_acquire(), for lock_release() to find it
+    lock->priority = t_current->priority;
+    list_insert_ordered(&(t_current->locks), &(lock->lockelem),
+        comparator_greater_lock_priority, NULL);
   }
   return success;
 }
 
+/* Acquires LOCK like lock_acquire(), but first waits for a while
+   without blocking if its holder is ready to run.
+
+   On a multiprocessor, the waiter would spin while the holder is
+   running on another CPU.  Here the holder cannot be running
+   while we are, but it may have been preempted inside its
+   critical section: then yielding the CPU to it a few times
+   usually has it release LOCK, for less than what blocking on
+   LOCK costs, with the priority donation and the wake-up that go
+   with it.  This only helps if the holder is ready to run at our
+   priority at least, otherwise yielding would not run it. */
+void
+lock_acquire_adaptive (struct lock *lock)
+{
+  int spins;
+
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (!lock_held_by_current_thread (lock));
+
+  for (spins = 0; spins < LOCK_SPIN_MAX; spins++)
+    {
+      enum intr_level old_level;
+      struct thread *holder;
+      bool runnable;
+
+      if (lock_try_acquire (lock))
+        return;
+
+      old_level = intr_disable ();
+      holder = lock->holder;
+      runnable = holder == NULL
+                 || (holder->status == THREAD_READY
+                     && holder->priority >= thread_get_priority ());
+      intr_set_level (old_level);
+      if (!runnable)
+        break;
+      thread_yield ();
+    }
+  lock_acquire (lock);
+}
+
 /* Releases LOCK, which must be owned by the current thread.
 
    An interrupt handler cannot acquire a lock, so it does not
@@ -314,6 +364,127 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
+/* Initializes RW, a readers-writer lock: any number of readers
+   may hold it at once, or a single writer.
+
+   The writer holds RW's inner lock for as long as it writes, and
+   a reader takes it just long enough to count itself in, so that:
+
+   - writers are preferred: once a writer is waiting for the
+     readers to leave, new readers queue up behind it;
+
+   - a thread waiting for RW donates its priority to the writer
+     holding or about to hold it, as it would for a lock, and the
+     waiters are let in by priority.
+
+   Readers do not receive donations, but no new reader gets in
+   while a writer waits, so the wait is bounded by the readers'
+   critical sections.  A thread must not acquire RW for writing
+   while it holds it for reading. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  rw->readers = 0;
+  rw->draining = false;
+  sema_init (&rw->drained, 0);
+}
+
+/* Acquires RW for reading, sleeping until no writer holds it or
+   waits for it if necessary.  Must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  old_level = intr_disable ();
+  rw->readers++;
+  intr_set_level (old_level);
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && rw->draining)
+    {
+      rw->draining = false;
+      sema_up (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Waits for the readers of RW, whose inner lock the current
+   thread holds, to leave. */
+static void
+rwlock_drain (struct rwlock *rw)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (rw->readers > 0)
+    {
+      rw->draining = true;
+      sema_down (&rw->drained);
+    }
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it if necessary.  Must not be called within an interrupt
+   handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  rwlock_drain (rw);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rwlock_held_by_current_thread (rw));
+
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return lock_held_by_current_thread (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing, or if
+   some thread holds it for reading, false otherwise.  Readers are
+   only counted, not recorded, so this cannot tell whether the
+   current thread is one of them; it is meant for assertions. */
+bool
+rwlock_held (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->readers > 0 || rwlock_held_by_current_thread (rw);
+}
+
 /* One semaphore in a list. */
 struct semaphore_elem
   {
@@ -410,6 +581,40 @@ cond_broadcast (struct condition *cond, struct lock *lock)
     cond_signal (cond, lock);
 }
 
+/* Like cond_wait(), for a condition variable associated with
+   the readers-writer lock RW, which must be held for writing. */
+void
+rwlock_cond_wait (struct condition *cond, struct rwlock *rw)
+{
+  ASSERT (rwlock_held_by_current_thread (rw));
+
+  cond_wait (cond, &rw->lock);
+
+  // readers may have come in while we waited
+  rwlock_drain (rw);
+}
+
+/* Like cond_signal(), for a condition variable associated with
+   the readers-writer lock RW, which must be held for writing. */
+void
+rwlock_cond_signal (struct condition *cond, struct rwlock *rw)
+{
+  ASSERT (rwlock_held_by_current_thread (rw));
+
+  cond_signal (cond, &rw->lock);
+}
+
+/* Like cond_broadcast(), for a condition variable associated
+   with the readers-writer lock RW, which must be held for
+   writing. */
+void
+rwlock_cond_broadcast (struct condition *cond, struct rwlock *rw)
+{
+  ASSERT (rwlock_held_by_current_thread (rw));
+
+  cond_broadcast (cond, &rw->lock);
+}
+
 /* Helpers */
 
 static bool
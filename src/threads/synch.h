@@ -30,10 +30,28 @@ struct lock
 
 void lock_init (struct lock *);
 void lock_acquire (struct lock *);
+void lock_acquire_adaptive (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock
+  {
+    struct lock lock;           /* Held by the writer, briefly by readers. */
+    unsigned readers;           /* Number of readers holding it. */
+    bool draining;              /* Writer waiting for the readers? */
+    struct semaphore drained;   /* Upped when the last reader leaves. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
+bool rwlock_held (const struct rwlock *);
+
 /* Condition variable. */
 struct condition
   {
@@ -44,6 +62,9 @@ void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
+void rwlock_cond_wait (struct condition *, struct rwlock *);
+void rwlock_cond_signal (struct condition *, struct rwlock *);
+void rwlock_cond_broadcast (struct condition *, struct rwlock *);
 
 /* Optimization barrier.
 
@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
@@ -11,6 +12,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -20,12 +22,37 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
-/* List of processes in sleep (wait) state (i.e. wait queue). */
-static struct list wait_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running:
+   a FIFO list per priority, and a bitmap of the non-empty ones,
+   so that both adding a thread and finding the one to run next
+   take constant time. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+static struct list ready_queues[PRI_CNT];
+static uint32_t ready_bitmap[DIV_ROUND_UP (PRI_CNT, 32)];
+static int ready_cnt;           /* Number of threads in it. */
+
+/* Processes in sleep (wait) state, in a hierarchical timing
+   wheel, so that a timer tick only looks at the ones whose time
+   has come, however many there are:
+
+   - those to wake up in the next WHEEL0_SIZE ticks are in
+     wheel0[], by tick;
+
+   - those to wake up in the next WHEEL0_SIZE * WHEEL1_SIZE
+     ticks, in wheel1[], by blocks of WHEEL0_SIZE ticks, whose
+     threads are spread over wheel0[] when the block begins;
+
+   - the others in far_sleepers, which is walked once every
+     WHEEL0_SIZE * WHEEL1_SIZE ticks. */
+#define WHEEL0_BITS 8
+#define WHEEL1_BITS 6
+#define WHEEL0_SIZE (1 << WHEEL0_BITS)
+#define WHEEL1_SIZE (1 << WHEEL1_BITS)
+static struct list wheel0[WHEEL0_SIZE];
+static struct list wheel1[WHEEL1_SIZE];
+static struct list far_sleepers;
+static int64_t wheel_tick;      /* Next tick to process. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -59,9 +86,38 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
-   Controlled by kernel command-line option "-o mlfqs". */
+   Controlled by kernel command-line option "-mlfqs". */
 bool thread_mlfqs;
 
+/* Multi-level feedback queue scheduler.
+
+   Once a second, every thread's recent_cpu decays by a factor
+   that depends on the load average, and so does its priority.
+   Rather than walking all the threads, that is done for the
+   running and ready threads only.  The factor of each second is
+   recorded in decay_factors[], and the recent_cpu of a blocked
+   thread catches up with the seconds it missed when it is
+   unblocked (see mlfqs_update()).  In between, only the running
+   thread's recent_cpu changes, so only its priority needs to be
+   recomputed every 4 ticks, and once more when it leaves the CPU
+   (in thread_yield(), or in thread_unblock() once it was blocked):
+   otherwise the ticks it ran since the last multiple of 4 would
+   not count until the next second. */
+#define DECAY_HISTORY 256       /* Seconds of decay factors kept. */
+static fixed_t load_avg;        /* System load average. */
+static int64_t mlfqs_seconds;   /* Seconds elapsed. */
+static fixed_t decay_factors[DECAY_HISTORY]; /* Factor of second S
+                                                at S % DECAY_HISTORY. */
+
+static void mlfqs_tick (int64_t tick);
+static void mlfqs_second (void);
+static void mlfqs_update (struct thread *);
+static void mlfqs_set_priority (struct thread *);
+
+/* Cycles spent in thread_tick(), that is, in the scheduler's
+   share of timer interrupts. */
+static uint64_t tick_cycles, tick_cycles_max;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -76,9 +132,9 @@ static tid_t allocate_tid (void);
 
 void thread_awake (int64_t current_tick);
 
-/* Helper (Auxiliary) functions */
-static bool comparator_greater_thread_priority
-  (const struct list_elem *, const struct list_elem *, void *aux);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static int ready_max_priority (void);
 
 
 /* Initializes the threading system by transforming the code
@@ -97,11 +153,18 @@ static bool comparator_greater_thread_priority
 void
 thread_init (void)
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
-  list_init (&wait_list);
+  for (i = 0; i < PRI_CNT; i++)
+    list_init (&ready_queues[i]);
+  for (i = 0; i < WHEEL0_SIZE; i++)
+    list_init (&wheel0[i]);
+  for (i = 0; i < WHEEL1_SIZE; i++)
+    list_init (&wheel1[i]);
+  list_init (&far_sleepers);
   list_init (&all_list);
 
   /* Set up a thread structure for the running thread. */
@@ -138,6 +201,7 @@ void
 thread_tick (int64_t tick)
 {
   struct thread *t = thread_current ();
+  uint64_t start = timer_tsc (), cycles;
 
   /* Update statistics. */
   if (t == idle_thread)
@@ -152,43 +216,213 @@ thread_tick (int64_t tick)
   /* Wake any thread whose ticks_end has been expired. */
   thread_awake(tick);
 
+  if (thread_mlfqs)
+    mlfqs_tick (tick);
+
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
+
+  cycles = timer_tsc () - start;
+  tick_cycles += cycles;
+  if (cycles > tick_cycles_max)
+    tick_cycles_max = cycles;
+}
+
+/* Advanced scheduler's work at each timer tick. */
+static void
+mlfqs_tick (int64_t tick)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur != idle_thread)
+    cur->recent_cpu = fp_add_int (cur->recent_cpu, 1);
+
+  if (tick % TIMER_FREQ == 0)
+    mlfqs_second ();
+  else if (tick % 4 == 0 && cur != idle_thread)
+    mlfqs_set_priority (cur);
+
+  if (ready_max_priority () > cur->priority)
+    intr_yield_on_return ();
+}
+
+/* Updates the load average, and the recent_cpu and priority of
+   the running and ready threads, once a second. */
+static void
+mlfqs_second (void)
+{
+  struct thread *cur = thread_current ();
+  int ready = ready_cnt + (cur != idle_thread ? 1 : 0);
+  fixed_t twice_load;
+  struct list threads;
+  int level;
+
+  load_avg = fp_mul (fp_from_int (59) / 60, load_avg)
+             + fp_from_int (ready) / 60;
+  twice_load = 2 * load_avg;
+  decay_factors[mlfqs_seconds % DECAY_HISTORY] =
+    fp_div (twice_load, fp_add_int (twice_load, 1));
+  mlfqs_seconds++;
+
+  if (cur != idle_thread)
+    mlfqs_update (cur);
+
+  /* Take the ready threads out, highest priority first, and put
+     them back at their new priorities. */
+  list_init (&threads);
+  for (level = PRI_CNT - 1; level >= 0; level--)
+    while (!list_empty (&ready_queues[level]))
+      list_push_back (&threads, list_pop_front (&ready_queues[level]));
+  memset (ready_bitmap, 0, sizeof ready_bitmap);
+  ready_cnt = 0;
+
+  while (!list_empty (&threads))
+    {
+      struct thread *t = list_entry (list_pop_front (&threads),
+                                     struct thread, elem);
+      mlfqs_update (t);
+      ready_push (t);
+    }
+}
+
+/* Applies to T, which must not be in the run queue, the decay of
+   recent_cpu of the seconds elapsed since it was last updated,
+   and recomputes its priority. */
+static void
+mlfqs_update (struct thread *t)
+{
+  for (; t->recent_seconds < mlfqs_seconds; t->recent_seconds++)
+    {
+      /* Beyond the recorded history, use the oldest factor. */
+      int64_t second = t->recent_seconds;
+      if (second < mlfqs_seconds - DECAY_HISTORY)
+        second = mlfqs_seconds - DECAY_HISTORY;
+
+      t->recent_cpu = fp_add_int (fp_mul (decay_factors[second % DECAY_HISTORY],
+                                          t->recent_cpu), t->nice);
+    }
+  mlfqs_set_priority (t);
+}
+
+/* Recomputes the priority of T, which must not be in the run
+   queue, from its recent_cpu and nice. */
+static void
+mlfqs_set_priority (struct thread *t)
+{
+  int priority = PRI_MAX - fp_to_int (t->recent_cpu / 4) - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+  t->priority = t->original_priority = priority;
+}
+
+/* Puts T, which is going to sleep, in the timing wheel. */
+static void
+sleeper_insert (struct thread *t)
+{
+  int64_t tick = t->sleep_endtick;
+
+  // (already due: wake it up at the next tick)
+  if (tick < wheel_tick)
+    tick = wheel_tick;
+
+  if (tick - wheel_tick < WHEEL0_SIZE)
+    list_push_back (&wheel0[tick % WHEEL0_SIZE], &t->waitelem);
+  else if (tick - wheel_tick < WHEEL0_SIZE * WHEEL1_SIZE)
+    list_push_back (&wheel1[(tick >> WHEEL0_BITS) % WHEEL1_SIZE], &t->waitelem);
+  else
+    list_push_back (&far_sleepers, &t->waitelem);
+}
+
+/* Moves the threads of LIST to their place in the timing wheel,
+   as of the current wheel_tick. */
+static void
+sleepers_cascade (struct list *list)
+{
+  struct list sleepers;
+
+  list_init (&sleepers);
+  while (!list_empty (list))
+    list_push_back (&sleepers, list_pop_front (list));
+  while (!list_empty (&sleepers))
+    sleeper_insert (list_entry (list_pop_front (&sleepers),
+                                struct thread, waitelem));
 }
 
 /* Wake up all sleeping threads whose ticks_end has been expired,
    removing from the wait queue and pushing it into the ready queue.
+   Only the threads due at each tick up to CURRENT_TICK are looked
+   at, apart from the ones moved within the timing wheel.
 
    This function must be called with interrupts turned off. */
 void
 thread_awake (int64_t current_tick) {
-  struct list_elem *e;
-
   // interrupt level check
   ASSERT (intr_get_level () == INTR_OFF);
 
-  // enumerate all threads in wait queue
-  for (e = list_begin (&wait_list); e != list_end (&wait_list); e = list_next (e))
+  for (; wheel_tick <= current_tick; wheel_tick++)
     {
-      struct thread *t = list_entry (e, struct thread, waitelem);
-      if (t->sleep_endtick <= current_tick) {
-        /* sleep is expired. awake up t */
-        t->sleep_endtick = 0;
-        list_remove (&t->waitelem);
-        // Add to run queue.
-        thread_unblock (t);
-      }
+      struct list *due = &wheel0[wheel_tick % WHEEL0_SIZE];
+
+      if (wheel_tick % (WHEEL0_SIZE * WHEEL1_SIZE) == 0)
+        sleepers_cascade (&far_sleepers);
+      if (wheel_tick % WHEEL0_SIZE == 0)
+        sleepers_cascade (&wheel1[(wheel_tick >> WHEEL0_BITS) % WHEEL1_SIZE]);
+
+      while (!list_empty (due))
+        {
+          struct thread *t = list_entry (list_pop_front (due),
+                                         struct thread, waitelem);
+          /* sleep is expired. awake up t */
+          t->sleep_endtick = 0;
+          // Add to run queue.
+          thread_unblock (t);
+        }
     }
 }
 
+/* Returns the tick at which the first sleeping thread is due, if
+   it is within the next MAX ticks, otherwise the tick MAX ticks
+   from the next one to process. */
+static int64_t
+thread_next_wakeup (int max)
+{
+  int64_t tick;
+
+  ASSERT (max < WHEEL0_SIZE);
+  for (tick = wheel_tick; tick < wheel_tick + max; tick++)
+    if (!list_empty (&wheel0[tick % WHEEL0_SIZE])
+        || (tick % WHEEL0_SIZE == 0
+            && !list_empty (&wheel1[(tick >> WHEEL0_BITS) % WHEEL1_SIZE]))
+        || (tick % (WHEEL0_SIZE * WHEEL1_SIZE) == 0
+            && !list_empty (&far_sleepers)))
+      break;
+  return tick;
+}
+
+/* Returns the cycles spent in thread_tick() since boot. */
+uint64_t
+thread_tick_cycles (void)
+{
+  enum intr_level old_level = intr_disable ();
+  uint64_t cycles = tick_cycles;
+  intr_set_level (old_level);
+  return cycles;
+}
 
 /* Prints thread statistics. */
 void
 thread_print_stats (void)
 {
+  long long ticks = idle_ticks + kernel_ticks + user_ticks;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  printf ("Scheduler: %llu cycles per timer tick on average, %llu at most\n",
+          ticks > 0 ? tick_cycles / ticks : 0, tick_cycles_max);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -215,6 +449,7 @@ thread_create (const char *name, int priority,
   struct switch_entry_frame *ef;
   struct switch_threads_frame *sf;
   tid_t tid;
+  int t_priority;
 
   ASSERT (function != NULL);
 
@@ -243,12 +478,13 @@ thread_create (const char *name, int priority,
   sf->ebp = 0;
 
   /* Add to run queue. */
+  t_priority = t->priority;   // (it may run, and exit, right away)
   thread_unblock (t);
 
   /* If the newly created thread has a higher priority than
    * the currently running thread, then there should be an
    * immediate context switching, for thread priority scheduling. */
-  if (priority > thread_current()->priority) {
+  if (t_priority > thread_current()->priority) {
     // current thread releases off its running
     thread_yield();
   }
@@ -268,7 +504,7 @@ thread_sleep_until (int64_t ticks_end)
   t->sleep_endtick = ticks_end;
 
   // put T into the wait queue
-  list_push_back (&wait_list, &t->waitelem);
+  sleeper_insert (t);
 
   // make the current thread block (sleeped)
   thread_block();
@@ -309,15 +545,22 @@ thread_unblock (struct thread *t)
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
 
-  // t will turn into ready-to-run state : inserting into ready_list
-  // maintaining in the non-decreasing order of thread priority
-  list_insert_ordered (&ready_list, &t->elem, comparator_greater_thread_priority, NULL);
+  // t will turn into ready-to-run state : at the back of its priority's queue
+  // (with the decay of recent_cpu it missed while blocked applied)
+  if (thread_mlfqs)
+    mlfqs_update (t);
+  ready_push (t);
 
   t->status = THREAD_READY;
 
   // ensure preemption : compare priorities of current thread and t (to be unblocked),
-  if (thread_current() != idle_thread && thread_current()->priority < t->priority )
-    thread_yield();
+  // (from an interrupt handler, e.g. a sleeper waking up, once it returns)
+  if (thread_current() != idle_thread && thread_current()->priority < t->priority ) {
+    if (intr_context ())
+      intr_yield_on_return ();
+    else
+      thread_yield();
+  }
 
   intr_set_level (old_level);
 }
@@ -397,8 +640,11 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread) {
-    // t will turn into ready-to-run state : inserting into ready_list
-    list_insert_ordered (&ready_list, &cur->elem, comparator_greater_thread_priority, NULL);
+    // t will turn into ready-to-run state : at the back of its priority's queue
+    // (with the ticks it ran since the last recompute counted)
+    if (thread_mlfqs)
+      mlfqs_set_priority (cur);
+    ready_push (cur);
   }
   cur->status = THREAD_READY;
   schedule ();
@@ -428,6 +674,10 @@ thread_foreach (thread_action_func *func, void *aux)
 void
 thread_set_priority (int new_priority)
 {
+  // the advanced scheduler sets priorities itself.
+  if (thread_mlfqs)
+    return;
+
   // if the current thread has no donation, then it is normal priority change request.
   struct thread *t_current = thread_current();
   if (t_current->priority == t_current->original_priority) {
@@ -440,12 +690,9 @@ thread_set_priority (int new_priority)
   }
 
   // if current thread gets its priority decreased, then yield
-  // (foremost entry in ready_list shall have the highest priority)
-  if (!list_empty (&ready_list)) {
-    struct thread *next = list_entry(list_begin(&ready_list), struct thread, elem);
-    if (next != NULL && next->priority > new_priority) {
-      thread_yield();
-    }
+  // (to the highest priority thread in the run queue)
+  if (ready_max_priority () > t_current->priority) {
+    thread_yield();
   }
 
 }
@@ -454,18 +701,29 @@ thread_set_priority (int new_priority)
 void
 thread_priority_donate(struct thread *target, int new_priority)
 {
-  // donation : change only current priority
-  target->priority = new_priority;
+  // no donation with the advanced scheduler.
+  if (thread_mlfqs)
+    return;
+
+  enum intr_level old_level = intr_disable ();
+
+  // donation : change only current priority,
+  // moving a ready thread to the queue of its new priority
+  if (target->status == THREAD_READY) {
+    ready_remove (target);
+    target->priority = new_priority;
+    ready_push (target);
+  }
+  else
+    target->priority = new_priority;
 
   // if current thread gets its priority decreased, then yield
-  // (foremost entry in ready_list shall have the highest priority)
-  if (target == thread_current() && !list_empty (&ready_list)) {
-    struct thread *next = list_entry(list_begin(&ready_list), struct thread, elem);
-    if (next != NULL && next->priority > new_priority) {
-      thread_yield();
-    }
+  // (to the highest priority thread in the run queue)
+  if (target == thread_current() && ready_max_priority () > new_priority) {
+    thread_yield();
   }
 
+  intr_set_level (old_level);
 }
 
 
@@ -476,37 +734,54 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE, and yields if
+   its priority is no longer the highest. */
 void
-thread_set_nice (int nice UNUSED)
+thread_set_nice (int nice)
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    {
+      mlfqs_set_priority (cur);
+      if (ready_max_priority () > cur->priority)
+        thread_yield ();
+    }
+  intr_set_level (old_level);
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load_avg_100 = fp_round (load_avg * 100);
+  intr_set_level (old_level);
+  return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void)
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu_100 = fp_round (thread_current ()->recent_cpu * 100);
+  intr_set_level (old_level);
+  return recent_cpu_100;
 }
-
+
 /* Idle thread.  Executes when no other thread is ready to run.
 
    The idle thread is initially put on the ready list by
@@ -529,6 +804,10 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nobody else to run: with tickless idle, have the timer
+         interrupt only when the first sleeping thread is due. */
+      timer_idle_enter (thread_next_wakeup (TIMER_IDLE_MAX));
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -582,12 +861,23 @@ is_thread (struct thread *t)
 static void
 init_thread (struct thread *t, const char *name, int priority)
 {
+  struct thread *parent = running_thread ();
   enum intr_level old_level;
+  int nice = NICE_DEFAULT;
+  fixed_t recent_cpu = 0;
 
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
 
+  /* New threads inherit nice and recent_cpu from their parent;
+     the initial thread starts with zeros. */
+  if (t != parent && is_thread (parent))
+    {
+      nice = parent->nice;
+      recent_cpu = parent->recent_cpu;
+    }
+
   memset (t, 0, sizeof *t);
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
@@ -597,7 +887,12 @@ init_thread (struct thread *t, const char *name, int priority)
   t->waiting_lock = NULL;
   list_init (&t->locks);
   t->sleep_endtick = 0;
+  t->nice = nice;
+  t->recent_cpu = recent_cpu;
+  t->recent_seconds = mlfqs_seconds;
   t->magic = THREAD_MAGIC;
+  if (thread_mlfqs && t != parent)
+    mlfqs_set_priority (t);
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
@@ -636,10 +931,59 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void)
 {
-  if (list_empty (&ready_list))
+  int priority = ready_max_priority ();
+  struct thread *t;
+
+  if (priority < PRI_MIN)
     return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+
+  t = list_entry (list_front (&ready_queues[priority - PRI_MIN]),
+                  struct thread, elem);
+  ready_remove (t);
+  return t;
+}
+
+/* Adds T, which is about to become ready, at the back of the run
+   queue of its priority.  Interrupts must be off. */
+static void
+ready_push (struct thread *t)
+{
+  int level = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  list_push_back (&ready_queues[level], &t->elem);
+  ready_bitmap[level / 32] |= 1u << (level % 32);
+  ready_cnt++;
+}
+
+/* Removes T, a ready thread, from the run queue.  Interrupts
+   must be off. */
+static void
+ready_remove (struct thread *t)
+{
+  int level = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[level]))
+    ready_bitmap[level / 32] &= ~(1u << (level % 32));
+  ready_cnt--;
+}
+
+/* Returns the highest priority of any ready thread, or
+   PRI_MIN - 1 if there are none. */
+static int
+ready_max_priority (void)
+{
+  int word;
+
+  for (word = DIV_ROUND_UP (PRI_CNT, 32) - 1; word >= 0; word--)
+    if (ready_bitmap[word] != 0)
+      return PRI_MIN + word * 32 + (31 - __builtin_clz (ready_bitmap[word]));
+  return PRI_MIN - 1;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -706,6 +1050,10 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  /* The idle thread may have stopped the periodic timer. */
+  if (cur == idle_thread)
+    timer_idle_exit ();
+
   if (cur != next)
     prev = switch_threads (cur, next);
   thread_schedule_tail (prev);
@@ -725,24 +1073,6 @@ allocate_tid (void)
   return tid;
 }
 
-/* Helper function: implementations */
-
-// A comparator function for thread priority, w.r.t ready_list element.
-// returns true iff (thread a)'s priority > (thread b)'s priority.
-static bool
-comparator_greater_thread_priority (
-    const struct list_elem *a,
-    const struct list_elem *b, void *aux UNUSED)
-{
-  struct thread *ta, *tb;
-  ASSERT (a != NULL);
-  ASSERT (b != NULL);
-  ta = list_entry (a, struct thread, elem);
-  tb = list_entry (b, struct thread, elem);
-  return ta->priority > tb->priority;
-}
-
-
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof (struct thread, stack);
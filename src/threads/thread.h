@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include "threads/fixed-point.h"
 
 #ifdef VM
 #include "vm/page.h"
@@ -28,6 +29,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, for the advanced scheduler. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -94,11 +100,16 @@ struct thread
     int priority;                       /* Priority. */
     int original_priority;              /* Priority, before donation */
     struct list_elem allelem;           /* List element for all threads list. */
-    struct list_elem waitelem;          /* List element, stored in the wait_list queue */
+    struct list_elem waitelem;          /* List element, stored in the timing wheel of sleepers */
     int64_t sleep_endtick;              /* The tick after which the thread should awake (if the thread is in sleep) */
 
+    // for the advanced scheduler (-mlfqs)
+    int nice;                           /* Niceness. */
+    fixed_t recent_cpu;                 /* CPU time received recently. */
+    int64_t recent_seconds;             /* Second up to which recent_cpu has decayed. */
+
     /* Shared between thread.c and synch.c. */
-    struct list_elem elem;              /* List element, stored in the ready_list queue */
+    struct list_elem elem;              /* List element, stored in a run queue (ready_queues) */
 
     // needed for priority donations
     struct lock *waiting_lock;          /* The lock object on which this thread is waiting (or NULL if not locked) */
@@ -141,7 +152,7 @@ struct thread
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
-   Controlled by kernel command-line option "-o mlfqs". */
+   Controlled by kernel command-line option "-mlfqs". */
 extern bool thread_mlfqs;
 
 void thread_init (void);
@@ -149,6 +160,7 @@ void thread_start (void);
 
 void thread_tick (int64_t tick);
 void thread_print_stats (void);
+uint64_t thread_tick_cycles (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
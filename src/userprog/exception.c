@@ -4,6 +4,7 @@
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/pagedir.h"
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
@@ -17,6 +18,13 @@
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+#ifdef VM
+/* Histogram of the time taken to load faulting pages, in timer
+   ticks: 0, 1, 2-3, 4-7, ..., and everything longer. */
+#define FAULT_LATENCY_BUCKETS 8
+static long long fault_latency_cnt[FAULT_LATENCY_BUCKETS];
+#endif
+
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
@@ -74,6 +82,19 @@ void
 exception_print_stats (void)
 {
   printf ("Exception: %lld page faults\n", page_fault_cnt);
+#ifdef VM
+  int i;
+  printf ("Page fault latency (ticks):");
+  for (i = 0; i < FAULT_LATENCY_BUCKETS; i++)
+    if (i == 0)
+      printf (" 0: %lld", fault_latency_cnt[i]);
+    else if (i == FAULT_LATENCY_BUCKETS - 1)
+      printf (", %d+: %lld", 1 << (i - 1), fault_latency_cnt[i]);
+    else
+      printf (", %d-%d: %lld", 1 << (i - 1), (1 << i) - 1,
+              fault_latency_cnt[i]);
+  printf ("\n");
+#endif
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -172,8 +193,14 @@ page_fault (struct intr_frame *f)
   void* fault_page = (void*) pg_round_down(fault_addr);
 
   if (!not_present) {
-    // attempt to write to a read-only region is always killed.
-    goto PAGE_FAULT_VIOLATED_ACCESS;
+    // attempt to write to a read-only region is always killed,
+    // but for the first write to a page on the shared zero frame
+    // or, if writable, in the page cache (copy-on-write), and for
+    // a page evicted since the fault, which is loaded again.
+    struct supplemental_page_table_entry *spte = vm_supt_lookup (curr->supt, fault_page);
+    if (!write || spte == NULL
+        || !vm_frame_write_fault_ok (spte, curr->pagedir))
+      goto PAGE_FAULT_VIOLATED_ACCESS;
   }
 
   /* (4.3.3) Obtain the current value of the user program's stack pointer.
@@ -194,7 +221,17 @@ page_fault (struct intr_frame *f)
       vm_supt_install_zeropage (curr->supt, fault_page);
   }
 
-  if(! vm_load_page(curr->supt, curr->pagedir, fault_page) ) {
+  int64_t start = timer_ticks ();
+  bool loaded = vm_load_page(curr->supt, curr->pagedir, fault_page, write);
+  int64_t latency = timer_elapsed (start);
+  int bucket = 0;
+  while (latency > 0 && bucket < FAULT_LATENCY_BUCKETS - 1) {
+    latency >>= 1;
+    bucket++;
+  }
+  fault_latency_cnt[bucket]++;
+
+  if(! loaded) {
     goto PAGE_FAULT_VIOLATED_ACCESS;
   }
 
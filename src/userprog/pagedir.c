@@ -8,6 +8,10 @@
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static bool demote_large_page (uint32_t *pd, uint32_t *pde);
+
+/* Number of large pages split into page tables. */
+unsigned long long pagedir_demote_cnt;
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -34,7 +38,9 @@ pagedir_destroy (uint32_t *pd)
 
   ASSERT (pd != init_page_dir);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P)
+    if ((*pde & PTE_P) && pde_is_large (*pde))
+      palloc_free_multiple (pde_get_large (*pde), LPGSIZE / PGSIZE);
+    else if (*pde & PTE_P)
       {
         uint32_t *pt = pde_get_pt (*pde);
         uint32_t *pte;
@@ -52,7 +58,11 @@ pagedir_destroy (uint32_t *pd)
    If PD does not have a page table for VADDR, behavior depends
    on CREATE.  If CREATE is true, then a new page table is
    created and a pointer into it is returned.  Otherwise, a null
-   pointer is returned. */
+   pointer is returned.
+   If VADDR is in a large page, then its PDE is returned, whose
+   present, accessed and dirty bits are those of the whole large
+   page, unless CREATE is true: then the large page is first
+   split into a page table (see demote_large_page()). */
 static uint32_t *
 lookup_page (uint32_t *pd, const void *vaddr, bool create)
 {
@@ -79,6 +89,13 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
       else
         return NULL;
     }
+  else if ((*pde & PTE_P) && pde_is_large (*pde))
+    {
+      if (!create)
+        return pde;
+      if (!demote_large_page (pd, pde))
+        return NULL;
+    }
 
   /* Return the page table entry. */
   pt = pde_get_pt (*pde);
@@ -118,6 +135,50 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
     return false;
 }
 
+/* Adds a mapping in page directory PD from the LPGSIZE bytes of
+   user virtual memory at UPAGE to the LPGSIZE bytes of physical
+   memory at kernel virtual address KPAGE, with a single large
+   page.  Both must be aligned on a LPGSIZE boundary.
+   Nothing in that range may be mapped yet, but a page table
+   without any page mapped is fine: it is freed.
+   If WRITABLE is true, the new page is read/write;
+   otherwise it is read-only.
+   Returns true if successful, false if large pages are not
+   supported or some page in the range is mapped. */
+bool
+pagedir_set_large_page (uint32_t *pd, void *upage, void *kpage,
+                        bool writable)
+{
+  uint32_t *pde;
+
+  ASSERT (((uintptr_t) upage & (LPGSIZE - 1)) == 0);
+  ASSERT (is_user_vaddr (upage) && is_user_vaddr (upage + LPGSIZE - 1));
+  ASSERT (vtop (kpage + LPGSIZE) >> PTSHIFT <= init_ram_pages);
+  ASSERT (pd != init_page_dir);
+
+  if (!init_large_pages)
+    return false;
+
+  pde = pd + pd_no (upage);
+  if (*pde != 0)
+    {
+      uint32_t *pt, *pte;
+
+      if (pde_is_large (*pde))
+        return false;
+      pt = pde_get_pt (*pde);
+      for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
+        if (*pte & PTE_P)
+          return false;
+      *pde = 0;
+      invalidate_pagedir (pd);
+      palloc_free_page (pt);
+    }
+
+  *pde = pde_create_large (kpage, writable, true);
+  return true;
+}
+
 /* Looks up the physical address that corresponds to user virtual
    address UADDR in PD.  Returns the kernel virtual address
    corresponding to that physical address, or a null pointer if
@@ -131,23 +192,48 @@ pagedir_get_page (uint32_t *pd, const void *uaddr)
 
   pte = lookup_page (pd, uaddr, false);
   if (pte != NULL && (*pte & PTE_P) != 0)
-    return pte_get_page (*pte) + pg_ofs (uaddr);
+    {
+      if (pte == pd + pd_no (uaddr))
+        return pde_get_large (*pte) + ((uintptr_t) uaddr & (LPGSIZE - 1));
+      return pte_get_page (*pte) + pg_ofs (uaddr);
+    }
   else
     return NULL;
 }
 
+/* Returns true if user virtual address UADDR is mapped by a
+   large page in PD, whose accessed and dirty bits are then
+   shared by all of its LPGSIZE bytes. */
+bool
+pagedir_is_large (uint32_t *pd, const void *uaddr)
+{
+  uint32_t pde;
+
+  ASSERT (is_user_vaddr (uaddr));
+
+  pde = pd[pd_no (uaddr)];
+  return (pde & PTE_P) != 0 && pde_is_large (pde);
+}
+
 /* Marks user virtual page UPAGE "not present" in page
    directory PD.  Later accesses to the page will fault.  Other
    bits in the page table entry are preserved.
-   UPAGE need not be mapped. */
+   UPAGE need not be mapped.  If it is in a large page, the
+   large page is split first, which may panic if no page table
+   can be allocated. */
 void
 pagedir_clear_page (uint32_t *pd, void *upage)
 {
-  uint32_t *pte;
+  uint32_t *pte, *pde;
 
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (is_user_vaddr (upage));
 
+  pde = pd + pd_no (upage);
+  if ((*pde & PTE_P) && pde_is_large (*pde)
+      && !demote_large_page (pd, pde))
+    PANIC ("pagedir_clear_page: out of memory splitting a large page");
+
   pte = lookup_page (pd, upage, false);
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
@@ -214,6 +300,30 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
     }
 }
 
+/* Splits the large page mapped by PDE, in PD, into a page table
+   mapping the same memory with 4 kB pages, each of which gets
+   the flags of the large page, including its accessed and dirty
+   bits.  Returns false if no page table can be allocated. */
+static bool
+demote_large_page (uint32_t *pd, uint32_t *pde)
+{
+  uint8_t *kpage = pde_get_large (*pde);
+  uint32_t flags = *pde & (PTE_FLAGS & ~PTE_PS);
+  uint32_t *pt;
+  size_t i;
+
+  pt = palloc_get_page (0);
+  if (pt == NULL)
+    return false;
+  for (i = 0; i < PGSIZE / sizeof *pt; i++)
+    pt[i] = vtop (kpage + i * PGSIZE) | flags;
+
+  *pde = pde_create (pt);
+  invalidate_pagedir (pd);
+  pagedir_demote_cnt++;
+  return true;
+}
+
 /* Loads page directory PD into the CPU's page directory base
    register. */
 void
@@ -654,8 +654,13 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       struct thread *curr = thread_current ();
       ASSERT (pagedir_get_page(curr->pagedir, upage) == NULL); // no virtual page yet?
 
-      if (! vm_supt_install_filesys(curr->supt, upage,
-            file, ofs, page_read_bytes, page_zero_bytes, writable) ) {
+      if (page_read_bytes == 0 && writable) {
+        // (part of) the BSS: all zero, nothing to read from the file.
+        if (! vm_supt_install_zeropage(curr->supt, upage) )
+          return false;
+      }
+      else if (! vm_supt_install_filesys(curr->supt, upage,
+            file, ofs, page_read_bytes, page_zero_bytes, writable, /*shared*/false) ) {
         return false;
       }
 #else
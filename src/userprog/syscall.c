@@ -57,7 +57,7 @@ bool sys_munmap(mmapid_t);
 
 static struct mmap_desc* find_mmap_desc(struct thread *, mmapid_t fd);
 
-void preload_and_pin_pages(const void *, size_t);
+bool preload_and_pin_pages(const void *, size_t);
 void unpin_preloaded_pages(const void *, size_t);
 #endif
 
@@ -537,7 +537,8 @@ int sys_read(int fd, void *buffer, unsigned size) {
     if(file_d && file_d->file) {
 
 #ifdef VM
-      preload_and_pin_pages(buffer, size);
+      if (!preload_and_pin_pages(buffer, size))
+        fail_invalid_access();
 #endif
 
       ret = file_read(file_d->file, buffer, size);
@@ -572,7 +573,8 @@ int sys_write(int fd, const void *buffer, unsigned size) {
 
     if(file_d && file_d->file) {
 #ifdef VM
-      preload_and_pin_pages(buffer, size);
+      if (!preload_and_pin_pages(buffer, size))
+        fail_invalid_access();
 #endif
 
       ret = file_write(file_d->file, buffer, size);
@@ -628,7 +630,7 @@ mmapid_t sys_mmap(int fd, void *upage) {
     size_t zero_bytes = PGSIZE - read_bytes;
 
     vm_supt_install_filesys(curr->supt, addr,
-        f, offset, read_bytes, zero_bytes, /*writable*/true);
+        f, offset, read_bytes, zero_bytes, /*writable*/true, /*shared*/true);
   }
 
   /* 3. Assign mmapid */
@@ -667,13 +669,8 @@ bool sys_munmap(mmapid_t mid)
 
   lock_acquire (&filesys_lock);
   {
-    // Iterate through each page
-    size_t offset, file_size = mmap_d->size;
-    for(offset = 0; offset < file_size; offset += PGSIZE) {
-      void *addr = mmap_d->addr + offset;
-      size_t bytes = (offset + PGSIZE < file_size ? PGSIZE : file_size - offset);
-      vm_supt_mm_unmap (curr->supt, curr->pagedir, addr, mmap_d->file, offset, bytes);
-    }
+    // Unmap all the pages, in batches
+    vm_supt_mm_unmap (curr->supt, curr->pagedir, mmap_d->addr, mmap_d->file, mmap_d->size);
 
     // Free resources, and remove from the list
     list_remove(& mmap_d->elem);
@@ -817,7 +814,8 @@ find_mmap_desc(struct thread *t, mmapid_t mid)
 }
 
 
-void preload_and_pin_pages(const void *buffer, size_t size)
+// returns false, with no page left pinned, if a page cannot be loaded.
+bool preload_and_pin_pages(const void *buffer, size_t size)
 {
   struct supplemental_page_table *supt = thread_current()->supt;
   uint32_t *pagedir = thread_current()->pagedir;
@@ -825,9 +823,13 @@ void preload_and_pin_pages(const void *buffer, size_t size)
   void *upage;
   for(upage = pg_round_down(buffer); upage < buffer + size; upage += PGSIZE)
   {
-    vm_load_page (supt, pagedir, upage);
-    vm_pin_page (supt, upage);
+    vm_load_page (supt, pagedir, upage, true);
+    if (!vm_pin_page (supt, upage)) {
+      unpin_preloaded_pages (pg_round_down (buffer), upage - pg_round_down (buffer));
+      return false;
+    }
   }
+  return true;
 }
 
 void unpin_preloaded_pages(const void *buffer, size_t size)
@@ -1,8 +1,12 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include "threads/synch.h"
 #include "userprog/process.h"
 
+/* Serializes the file system calls. */
+extern struct lock filesys_lock;
+
 void syscall_init (void);
 
 void sys_exit (int);
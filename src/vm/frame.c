@@ -1,14 +1,22 @@
 #include <hash.h>
 #include <list.h>
 #include <stdio.h>
+#include <string.h>
 #include "lib/kernel/hash.h"
 #include "lib/kernel/list.h"
 
 #include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
+#include "filesys/file.h"
+#include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/pte.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "threads/vaddr.h"
 
 
@@ -21,6 +29,33 @@ static struct hash frame_map;
 /* A (circular) list of frames for the clock eviction algorithm. */
 static struct list frame_list;      /* the list */
 static struct list_elem *clock_ptr; /* the pointer in clock algorithm */
+static struct list_elem *front_ptr; /* the front hand, in two-handed clock */
+static bool history_aged;           /* reference histories aged, in this eviction (LRU-2) */
+
+/* Page replacement policy. */
+enum vm_evict_policy vm_frame_policy = VM_EVICT_CLOCK;
+
+/* The page-out daemon keeps between vm_frame_low_water and twice
+   that many user pages free, so that page faults seldom have to
+   evict (and write out) a frame themselves.  -1 picks a default
+   from the size of the user pool; 0 disables the daemon. */
+int vm_frame_low_water = -1;
+static size_t low_water, high_water;
+static struct condition pageout_wakeup;  /* Signaled below low_water. */
+
+/* Signaled whenever an eviction completes. */
+static struct condition eviction_done;
+
+/* Statistics. */
+static unsigned long long alloc_cnt;      /* Frames allocated. */
+static unsigned long long direct_cnt;     /* Evictions by allocators. */
+static unsigned long long pageout_cnt;    /* Evictions by the daemon. */
+static unsigned long long drop_cnt;       /* Clean file pages dropped. */
+static unsigned long long writeback_cnt;  /* Dirty mmap pages written back. */
+static unsigned long long swap_cnt;       /* Pages written to swap. */
+static unsigned long long cache_hit_cnt;  /* Page cache: frames shared, */
+static unsigned long long cache_miss_cnt; /* frames read in, */
+static unsigned long long cow_cnt;        /* and copied on write. */
 
 static unsigned frame_hash_func(const struct hash_elem *elem, void *aux);
 static bool     frame_less_func(const struct hash_elem *, const struct hash_elem *, void *aux);
@@ -40,11 +75,44 @@ struct frame_table_entry
 
     bool pinned;               /* Used to prevent a frame from being evicted, while it is acquiring some resources.
                                   If it is true, it is never evicted. */
+    bool evicting;             /* Being written out, with frame_lock released. */
+    uint8_t history;           /* Reference history, most recent in bit 7 (LRU-2). */
+
+    // for frames of the page cache, which have no single owner (t == NULL)
+    struct hash_elem cache_elem; /* see ::page_cache */
+    struct inode *inode;       /* The page of the file it holds (the key): */
+    off_t offset;              /*   file offset, */
+    uint32_t read_bytes;       /*   and bytes read from there. */
+    struct list mappings;      /* The pages mapping it (struct frame_mapping). */
+    size_t ref_cnt;            /* Number of mappings. */
+    size_t pin_cnt;            /* Number of processes that pinned it. */
+  };
+
+/**
+ * A mapping of a frame of the page cache, read-only, by a process.
+ */
+struct frame_mapping
+  {
+    struct thread *t;
+    struct supplemental_page_table_entry *spte;
+    struct list_elem elem;     /* see frame_table_entry::mappings */
   };
 
+/* The page cache: frames holding pages of files, shared read-only by
+   all the processes mapping those pages privately (executables).
+   Keyed by (inode, offset, read_bytes), protected by frame_lock. */
+static struct hash page_cache;
+
+static unsigned cache_hash_func(const struct hash_elem *elem, void *aux);
+static bool     cache_less_func(const struct hash_elem *, const struct hash_elem *, void *aux);
+
 
-static struct frame_table_entry* pick_frame_to_evict(uint32_t* pagedir);
+static struct frame_table_entry* pick_frame_to_evict(void);
 static void vm_frame_do_free (void *kpage, bool free_page);
+static size_t vm_frame_evict (size_t max, bool *fs_busy);
+static struct frame_table_entry* vm_frame_lookup (void *kpage);
+static struct frame_table_entry* vm_frame_wait_eviction (void *kpage);
+static void frame_unshare (struct supplemental_page_table_entry *spte, uint32_t *pagedir);
 
 
 void
@@ -52,8 +120,56 @@ vm_frame_init ()
 {
   lock_init (&frame_lock);
   hash_init (&frame_map, frame_hash_func, frame_less_func, NULL);
+  hash_init (&page_cache, cache_hash_func, cache_less_func, NULL);
   list_init (&frame_list);
   clock_ptr = NULL;
+  front_ptr = NULL;
+  cond_init (&pageout_wakeup);
+  cond_init (&eviction_done);
+}
+
+static void pageout_daemon (void *aux);
+
+/**
+ * Start the page-out daemon.
+ * Must be called after the swap is initialized.
+ */
+void
+vm_frame_init_pageout (void)
+{
+  if (vm_frame_low_water < 0) {
+    low_water = palloc_free_cnt (PAL_USER) / 32;
+    if (low_water < 8) low_water = 8;
+  }
+  else
+    low_water = vm_frame_low_water;
+  high_water = low_water * 2;
+
+  if (low_water > 0)
+    thread_create ("pageout", PRI_DEFAULT, pageout_daemon, NULL);
+}
+
+/**
+ * The page-out daemon: whenever the number of free user pages
+ * drops below the low watermark, evicts frames until it reaches
+ * the high watermark.
+ */
+static void
+pageout_daemon (void *aux UNUSED)
+{
+  lock_acquire (&frame_lock);
+  for (;;) {
+    cond_wait (&pageout_wakeup, &frame_lock);
+
+    size_t free_cnt;
+    while ((free_cnt = palloc_free_cnt (PAL_USER)) < high_water) {
+      // evict in clusters, which go to swap in a single write.
+      size_t evicted = vm_frame_evict (high_water - free_cnt, NULL);
+      if (evicted == 0)
+        break;  // everything is pinned; wait for the next allocation
+      pageout_cnt += evicted;
+    }
+  }
 }
 
 /**
@@ -66,35 +182,33 @@ vm_frame_allocate (enum palloc_flags flags, void *upage)
   lock_acquire (&frame_lock);
 
   void *frame_page = palloc_get_page (PAL_USER | flags);
-  if (frame_page == NULL) {
-    // page allocation failed.
-
-    /* first, swap out the page */
-    struct frame_table_entry *f_evicted = pick_frame_to_evict( thread_current()->pagedir );
-
-#if DEBUG
-    printf("f_evicted: %x th=%x, pagedir = %x, up = %x, kp = %x, hash_size=%d\n", f_evicted, f_evicted->t,
-        f_evicted->t->pagedir, f_evicted->upage, f_evicted->kpage, hash_size(&frame_map));
-#endif
-    ASSERT (f_evicted != NULL && f_evicted->t != NULL);
-
-    // clear the page mapping, and replace it with swap
-    ASSERT (f_evicted->t->pagedir != (void*)0xcccccccc);
-    pagedir_clear_page(f_evicted->t->pagedir, f_evicted->upage);
-
-    bool is_dirty = false;
-    is_dirty = is_dirty || pagedir_is_dirty(f_evicted->t->pagedir, f_evicted->upage);
-    is_dirty = is_dirty || pagedir_is_dirty(f_evicted->t->pagedir, f_evicted->kpage);
-
-    swap_index_t swap_idx = vm_swap_out( f_evicted->kpage );
-    vm_supt_set_swap(f_evicted->t->supt, f_evicted->upage, swap_idx);
-    vm_supt_set_dirty(f_evicted->t->supt, f_evicted->upage, is_dirty);
-    vm_frame_do_free(f_evicted->kpage, true); // f_evicted is also invalidated
+  while (frame_page == NULL) {
+    // page allocation failed: the page-out daemon fell behind,
+    // so evict a frame ourselves (direct reclaim).
+    bool fs_busy;
+    size_t evicted = vm_frame_evict (1, &fs_busy);
+    if (evicted == 0 && fs_busy) {
+      // only dirty pages of memory-mapped files are left, and someone
+      // else has filesys_lock: wait for it, then write one back.
+      lock_release (&frame_lock);
+      lock_acquire (&filesys_lock);
+      lock_acquire (&frame_lock);
+      evicted = vm_frame_evict (1, NULL);
+      lock_release (&filesys_lock);
+    }
+    if (evicted == 0)
+      PANIC ("Can't evict any frame -- Not enough memory!\n");
+    direct_cnt++;
 
+    // frame_lock was released while writing out the victim,
+    // so someone else may have taken the freed page already.
     frame_page = palloc_get_page (PAL_USER | flags);
-    ASSERT (frame_page != NULL); // should success in this chance
   }
 
+  // wake the page-out daemon up before we run out of pages again.
+  if (palloc_free_cnt (PAL_USER) < low_water)
+    cond_signal (&pageout_wakeup, &frame_lock);
+
   struct frame_table_entry *frame = malloc(sizeof(struct frame_table_entry));
   if(frame == NULL) {
     // frame allocation failed. a critical state or panic?
@@ -106,6 +220,9 @@ vm_frame_allocate (enum palloc_flags flags, void *upage)
   frame->upage = upage;
   frame->kpage = frame_page;
   frame->pinned = true;         // can't be evicted yet
+  frame->evicting = false;
+  frame->history = 0x80;        // just referenced
+  alloc_cnt++;
 
   // insert into hash table
   hash_insert (&frame_map, &frame->helem);
@@ -115,6 +232,58 @@ vm_frame_allocate (enum palloc_flags flags, void *upage)
   return frame_page;
 }
 
+/**
+ * Allocate the frames of the `LPGSIZE / PGSIZE` pages starting at `upage`,
+ * on physically contiguous memory aligned for a large page, and return
+ * the address of the first one; they are all pinned, like a frame of
+ * vm_frame_allocate().  No frame is evicted to make room for them:
+ * returns NULL if there is no such free memory.
+ */
+void*
+vm_frame_allocate_large (void *upage)
+{
+  const size_t cnt = LPGSIZE / PGSIZE;
+  struct frame_table_entry **frames = malloc (cnt * sizeof *frames);
+  size_t i;
+
+  if (frames == NULL)
+    return NULL;
+  for (i = 0; i < cnt; i++) {
+    frames[i] = malloc (sizeof(struct frame_table_entry));
+    if (frames[i] == NULL) {
+      while (i-- > 0) free (frames[i]);
+      free (frames);
+      return NULL;
+    }
+  }
+
+  lock_acquire (&frame_lock);
+  uint8_t *kpage = palloc_get_aligned (PAL_USER, cnt, LPGSIZE);
+  if (kpage != NULL) {
+    for (i = 0; i < cnt; i++) {
+      struct frame_table_entry *frame = frames[i];
+      frame->t = thread_current ();
+      frame->upage = upage + i * PGSIZE;
+      frame->kpage = kpage + i * PGSIZE;
+      frame->pinned = true;
+      frame->evicting = false;
+      frame->history = 0x80;
+      hash_insert (&frame_map, &frame->helem);
+      list_push_back (&frame_list, &frame->lelem);
+    }
+    alloc_cnt += cnt;
+
+    if (palloc_free_cnt (PAL_USER) < low_water)
+      cond_signal (&pageout_wakeup, &frame_lock);
+  }
+  lock_release (&frame_lock);
+
+  if (kpage == NULL)
+    for (i = 0; i < cnt; i++) free (frames[i]);
+  free (frames);
+  return kpage;
+}
+
 /**
  * Deallocate a frame or page.
  */
@@ -127,14 +296,504 @@ vm_frame_free (void *kpage)
 }
 
 /**
- * Just removes then entry from table, do not palloc free.
+ * Deallocates the frames at the `cnt` pages `kpages`, all at once.
+ */
+void
+vm_frame_free_multiple (void *kpages[], size_t cnt)
+{
+  size_t i;
+
+  lock_acquire (&frame_lock);
+  for (i = 0; i < cnt; i++)
+    vm_frame_do_free (kpages[i], true);
+  lock_release (&frame_lock);
+}
+
+/**
+ * Pins the frames of those of the `cnt` pages `sptes` of the current
+ * process that are in memory, all at once, waiting for the ones being
+ * evicted to be written out (they are then no longer in memory).
+ */
+void
+vm_frame_pin_multiple (struct supplemental_page_table_entry *sptes[], size_t cnt)
+{
+  size_t i;
+
+  lock_acquire (&frame_lock);
+  for (i = 0; i < cnt; i++) {
+    struct frame_table_entry *f = NULL;
+    while (sptes[i]->status == ON_FRAME) {
+      f = vm_frame_lookup (sptes[i]->kpage);
+      if (f == NULL || !f->evicting)
+        break;
+      cond_wait (&eviction_done, &frame_lock);
+    }
+    if (sptes[i]->status == ON_FRAME && f != NULL)
+      f->pinned = true;
+  }
+  lock_release (&frame_lock);
+}
+
+/* Returns the mapping of the page cache frame F by thread T, or NULL. */
+static struct frame_mapping*
+frame_find_mapping (struct frame_table_entry *f, struct thread *t)
+{
+  struct list_elem *el;
+  for (el = list_begin (&f->mappings); el != list_end (&f->mappings);
+       el = list_next (el)) {
+    struct frame_mapping *m = list_entry (el, struct frame_mapping, elem);
+    if (m->t == t)
+      return m;
+  }
+  return NULL;
+}
+
+/**
+ * Releases all the frames of the exiting current process, with page
+ * directory `pagedir`, in a single pass over the frame table: its own
+ * frames leave the table (the pages themselves are freed along with
+ * the page directory), and its mappings of the page cache are dropped.
+ * Frames being evicted are waited for, which leaves their pages on swap.
  */
 void
-vm_frame_remove_entry (void *kpage)
+vm_frame_release_all (uint32_t *pagedir)
+{
+  struct thread *cur = thread_current ();
+  struct list_elem *el;
+
+  lock_acquire (&frame_lock);
+  el = list_begin (&frame_list);
+  while (el != list_end (&frame_list)) {
+    struct frame_table_entry *f = list_entry (el, struct frame_table_entry, lelem);
+    struct list_elem *next = list_next (el);
+
+    if (f->t == cur) {
+      if (f->evicting) {
+        // the list may change while we wait: start over.
+        cond_wait (&eviction_done, &frame_lock);
+        el = list_begin (&frame_list);
+        continue;
+      }
+      vm_frame_do_free (f->kpage, false);
+    }
+    else if (f->t == NULL) {
+      struct frame_mapping *m;
+      bool freed = false;
+      while (!freed && (m = frame_find_mapping (f, cur)) != NULL) {
+        freed = f->ref_cnt == 1;
+        frame_unshare (m->spte, pagedir);
+      }
+    }
+    el = next;
+  }
+  lock_release (&frame_lock);
+}
+
+/* Returns the frame of the page cache holding the page of `spte`, or NULL. */
+static struct frame_table_entry*
+page_cache_lookup (struct supplemental_page_table_entry *spte)
+{
+  struct frame_table_entry f_tmp;
+  f_tmp.inode = file_get_inode (spte->file);
+  f_tmp.offset = spte->file_offset;
+  f_tmp.read_bytes = spte->read_bytes;
+
+  struct hash_elem *h = hash_find (&page_cache, &f_tmp.cache_elem);
+  if (h == NULL) return NULL;
+  return hash_entry(h, struct frame_table_entry, cache_elem);
+}
+
+/**
+ * Maps the page of `spte`, a private page of a file which is not in
+ * memory, read-only into `pagedir`, to the frame of the page cache
+ * holding that page of the file; reads it into a new one first if
+ * there is none. The page becomes ON_SHARED.
+ * Returns false if the page can't be read or mapped.
+ */
+bool
+vm_frame_get_shared (struct supplemental_page_table_entry *spte, uint32_t *pagedir)
+{
+  ASSERT (spte->status == FROM_FILESYS && spte->file != NULL && !spte->shared);
+
+  struct frame_mapping *m = malloc (sizeof *m);
+  if (m == NULL)
+    return false;
+  m->t = thread_current ();
+  m->spte = spte;
+
+  lock_acquire (&frame_lock);
+  struct frame_table_entry *f = page_cache_lookup (spte);
+  if (f != NULL)
+    cache_hit_cnt++;
+  else {
+    // read it into a frame of our own, then hand it to the page cache.
+    lock_release (&frame_lock);
+    void *kpage = vm_frame_allocate (PAL_USER, spte->upage);
+    if (kpage == NULL) {
+      free (m);
+      return false;
+    }
+    if (file_read_at (spte->file, kpage, spte->read_bytes, spte->file_offset)
+        != (int) spte->read_bytes) {
+      vm_frame_free (kpage);
+      free (m);
+      return false;
+    }
+    memset (kpage + spte->read_bytes, 0, PGSIZE - spte->read_bytes);
+    lock_acquire (&frame_lock);
+
+    // another process may have read it meanwhile.
+    f = page_cache_lookup (spte);
+    if (f != NULL) {
+      vm_frame_do_free (kpage, true);
+      cache_hit_cnt++;
+    }
+    else {
+      f = vm_frame_lookup (kpage);
+      f->t = NULL;
+      f->upage = NULL;
+      f->inode = file_get_inode (spte->file);
+      f->offset = spte->file_offset;
+      f->read_bytes = spte->read_bytes;
+      list_init (&f->mappings);
+      f->ref_cnt = 0;
+      f->pin_cnt = 0;
+      f->pinned = false;
+      hash_insert (&page_cache, &f->cache_elem);
+      cache_miss_cnt++;
+    }
+  }
+
+  if (!pagedir_set_page (pagedir, spte->upage, f->kpage, false)) {
+    if (f->ref_cnt == 0)
+      vm_frame_do_free (f->kpage, true);
+    lock_release (&frame_lock);
+    free (m);
+    return false;
+  }
+  list_push_back (&f->mappings, &m->elem);
+  f->ref_cnt++;
+  spte->kpage = f->kpage;
+  spte->status = ON_SHARED;
+
+  lock_release (&frame_lock);
+  return true;
+}
+
+/**
+ * Unmaps the ON_SHARED page of `spte` from `pagedir` (unless NULL),
+ * dropping its reference to the frame of the page cache, which is
+ * freed with the last one. The page becomes FROM_FILESYS again.
+ * MUST BE CALLED with 'frame_lock' held.
+ */
+static void
+frame_unshare (struct supplemental_page_table_entry *spte, uint32_t *pagedir)
+{
+  ASSERT (lock_held_by_current_thread(&frame_lock) == true);
+  ASSERT (spte->status == ON_SHARED);
+
+  struct frame_table_entry *f = vm_frame_lookup (spte->kpage);
+  ASSERT (f != NULL && f->t == NULL);
+
+  struct list_elem *el;
+  for (el = list_begin (&f->mappings); el != list_end (&f->mappings);
+       el = list_next (el)) {
+    struct frame_mapping *m = list_entry (el, struct frame_mapping, elem);
+    if (m->spte == spte) {
+      list_remove (el);
+      free (m);
+      break;
+    }
+  }
+
+  if (pagedir != NULL)
+    pagedir_clear_page (pagedir, spte->upage);
+  spte->status = FROM_FILESYS;
+  spte->kpage = NULL;
+
+  if (--f->ref_cnt == 0)
+    vm_frame_do_free (f->kpage, true);
+}
+
+/**
+ * Returns true if a write fault on the present page of `spte` can be
+ * resolved by vm_load_page(): the first write to a page on the zero
+ * frame or to a writable page in the page cache, or a page that has
+ * been unmapped meanwhile (by eviction), which is just loaded again.
+ * Returns false if the page is mapped read-only for good.
+ * Checked under frame_lock, since eviction may change the page's
+ * status concurrently.
+ */
+bool
+vm_frame_write_fault_ok (struct supplemental_page_table_entry *spte,
+    uint32_t *pagedir)
+{
+  lock_acquire (&frame_lock);
+  bool ok = pagedir_get_page (pagedir, spte->upage) == NULL
+    || spte->status == ON_ZERO_FRAME
+    || (spte->status == ON_SHARED && spte->writable);
+  lock_release (&frame_lock);
+  return ok;
+}
+
+/**
+ * Copy-on-write: copies the ON_SHARED page of `spte` into `kpage`, a
+ * frame of the current process, and drops its mapping to the page
+ * cache. Returns false, with nothing copied, if the page has been
+ * evicted meanwhile (it is then FROM_FILESYS).
+ */
+bool
+vm_frame_copy_shared (struct supplemental_page_table_entry *spte, uint32_t *pagedir,
+    void *kpage)
 {
   lock_acquire (&frame_lock);
-  vm_frame_do_free (kpage, false);
+  bool shared = spte->status == ON_SHARED;
+  if (shared) {
+    memcpy (kpage, spte->kpage, PGSIZE);
+    frame_unshare (spte, pagedir);
+    cow_cnt++;
+  }
   lock_release (&frame_lock);
+  return shared;
+}
+
+/**
+ * Evicts up to `max` (at most SWAP_CLUSTER) frames chosen by the
+ * replacement policy. Returns the number of frames evicted, which is 0
+ * if every frame is pinned or being evicted. If `fs_busy` is not NULL,
+ * sets it to whether some frames were passed over for lack of
+ * filesys_lock (see below).
+ *
+ * Where a page goes depends on where it came from:
+ *  - clean pages of a file are just dropped, to be read again later;
+ *  - dirty pages of a memory-mapped file are written back to the file,
+ *    under filesys_lock (they are passed over while someone else holds
+ *    it, unless the current thread does);
+ *  - anything else (anonymous pages, modified private pages of an
+ *    executable) is written to swap, all victims of a call together,
+ *    into contiguous swap slots when possible.
+ *
+ * MUST BE CALLED with 'frame_lock' held. The lock is released while
+ * the victims are written out, so that other threads can allocate and
+ * free frames meanwhile; the victims are marked as `evicting` so that
+ * their owners wait for the eviction to finish instead of using them.
+ */
+static size_t
+vm_frame_evict (size_t max, bool *fs_busy)
+{
+  ASSERT (lock_held_by_current_thread(&frame_lock) == true);
+
+  // victims to be written out, to files or to swap.
+  struct victim
+    {
+      struct thread *t;
+      void *upage, *kpage;
+      bool dirty;
+      struct supplemental_page_table_entry *spte;
+    };
+  struct victim to_file[SWAP_CLUSTER], to_swap[SWAP_CLUSTER];
+  size_t file_cnt = 0, swap_victim_cnt = 0, evicted = 0;
+
+  // frames of memory-mapped files, left alone for lack of filesys_lock.
+  struct frame_table_entry *skipped[SWAP_CLUSTER];
+  size_t skip_cnt = 0;
+  bool fs_held = lock_held_by_current_thread (&filesys_lock);
+  bool fs_taken = false;
+
+  if (max > SWAP_CLUSTER) max = SWAP_CLUSTER;
+  history_aged = false;
+  while (evicted < max) {
+    struct frame_table_entry *f_evicted = pick_frame_to_evict();
+    if (f_evicted == NULL)
+      break;
+
+#if DEBUG
+    printf("f_evicted: %x th=%x, pagedir = %x, up = %x, kp = %x, hash_size=%d\n", f_evicted, f_evicted->t,
+        f_evicted->t->pagedir, f_evicted->upage, f_evicted->kpage, hash_size(&frame_map));
+#endif
+    if (f_evicted->t == NULL) {
+      // a frame of the page cache: unmap it from all processes, which
+      // will read it from the file again (or share it again, if one
+      // of them does first).
+      size_t ref_cnt = f_evicted->ref_cnt;
+      while (ref_cnt-- > 0) {   // the last one frees f_evicted
+        struct frame_mapping *m = list_entry (list_front (&f_evicted->mappings),
+                                              struct frame_mapping, elem);
+        frame_unshare (m->spte, m->t->pagedir);
+      }
+      evicted++;
+      drop_cnt++;
+      continue;
+    }
+
+    struct victim v;
+    v.t = f_evicted->t;
+    v.upage = f_evicted->upage;
+    v.kpage = f_evicted->kpage;
+    v.spte = vm_supt_lookup (v.t->supt, v.upage);
+    ASSERT (v.spte != NULL);
+    ASSERT (v.t->pagedir != (void*)0xcccccccc);
+
+    // the page must not be modified between the dirty test and the
+    // unmapping, lest a clean mmap page become dirty without
+    // filesys_lock: the owner can't run meanwhile with interrupts off.
+    enum intr_level old_level = intr_disable ();
+    v.dirty = false;
+    v.dirty = v.dirty || pagedir_is_dirty(v.t->pagedir, v.upage);
+    v.dirty = v.dirty || pagedir_is_dirty(v.t->pagedir, v.kpage);
+
+    // writing back to a memory-mapped file needs filesys_lock. We may
+    // not wait for it, as its holder may be waiting for this eviction
+    // (e.g. to pin a buffer); if it is taken, pick another frame.
+    if (v.spte->file != NULL && v.spte->shared && (v.spte->dirty || v.dirty)
+        && !fs_held) {
+      fs_held = fs_taken = lock_try_acquire (&filesys_lock);
+      if (!fs_held) {
+        intr_set_level (old_level);
+        f_evicted->pinned = true;
+        skipped[skip_cnt++] = f_evicted;
+        if (skip_cnt == SWAP_CLUSTER)
+          break;
+        continue;
+      }
+    }
+
+    // clear the page mapping, and replace it with swap
+    pagedir_clear_page(v.t->pagedir, v.upage);
+    intr_set_level (old_level);
+
+    f_evicted->evicting = true;
+    evicted++;
+
+    if (v.spte->file != NULL && !v.spte->dirty && !v.dirty) {
+      // an unmodified copy of the file: nothing to write.
+      vm_supt_set_filesys(v.t->supt, v.upage);
+      vm_frame_do_free(v.kpage, true); // f_evicted is also invalidated
+      drop_cnt++;
+    }
+    else if (v.spte->file != NULL && v.spte->shared)
+      to_file[file_cnt++] = v;   // memory-mapped file: write back to the file itself.
+    else
+      to_swap[swap_victim_cnt++] = v;
+  }
+
+  size_t i;
+  for (i = 0; i < skip_cnt; i++)
+    skipped[i]->pinned = false;
+  if (fs_busy != NULL)
+    *fs_busy = skip_cnt > 0;
+
+  if (file_cnt == 0 && swap_victim_cnt == 0) {
+    if (fs_taken)
+      lock_release (&filesys_lock);
+    return evicted;
+  }
+
+  lock_release (&frame_lock);
+  for (i = 0; i < file_cnt; i++)
+    file_write_at (to_file[i].spte->file, to_file[i].kpage,
+                   to_file[i].spte->read_bytes, to_file[i].spte->file_offset);
+  if (fs_taken)
+    lock_release (&filesys_lock);
+
+  // the compressed swap first; what does not go there goes to the disk.
+  void *pages[SWAP_CLUSTER];
+  swap_index_t swap_indexes[SWAP_CLUSTER];
+  zswap_index_t zswap_indexes[SWAP_CLUSTER];
+  bool compressed[SWAP_CLUSTER];
+  size_t disk_cnt = 0, swapped_cnt = 0;
+  for (i = 0; i < swap_victim_cnt; i++) {
+    compressed[i] = vm_zswap_out (to_swap[i].kpage, &zswap_indexes[i]);
+    if (!compressed[i])
+      pages[disk_cnt++] = to_swap[i].kpage;
+  }
+  if (disk_cnt > 0)
+    swapped_cnt = vm_swap_out_multiple (pages, disk_cnt, swap_indexes);
+  lock_acquire (&frame_lock);
+
+  // the owners and their pages can't have gone away: an exiting owner
+  // waits in vm_frame_release_all() (from vm_supt_destroy()) for its
+  // frames still `evicting`, and munmap and the page loads wait in
+  // vm_frame_pin_multiple() and vm_frame_wait().
+  for (i = 0; i < file_cnt; i++) {
+    vm_supt_set_filesys(to_file[i].t->supt, to_file[i].upage);
+    vm_frame_do_free(to_file[i].kpage, true);
+    writeback_cnt++;
+  }
+  for (i = 0, disk_cnt = 0; i < swap_victim_cnt; i++) {
+    if (compressed[i])
+      vm_supt_set_zswap(to_swap[i].t->supt, to_swap[i].upage, zswap_indexes[i]);
+    else if (disk_cnt < swapped_cnt)
+      vm_supt_set_swap(to_swap[i].t->supt, to_swap[i].upage, swap_indexes[disk_cnt++]);
+    else {
+      // the swap disk is full: give the page back to its owner, with
+      // its mapping as it was, and let the next eviction pick another.
+      struct frame_table_entry *f = vm_frame_lookup (to_swap[i].kpage);
+      bool writable = to_swap[i].spte->file == NULL || to_swap[i].spte->writable;
+      if (!pagedir_set_page (to_swap[i].t->pagedir, to_swap[i].upage,
+                             to_swap[i].kpage, writable))
+        PANIC ("Can't map back a frame that did not fit in swap");
+      pagedir_set_dirty (to_swap[i].t->pagedir, to_swap[i].upage, to_swap[i].dirty);
+      f->evicting = false;
+      evicted--;
+      continue;
+    }
+    vm_supt_set_dirty(to_swap[i].t->supt, to_swap[i].upage, to_swap[i].dirty);
+    vm_frame_do_free(to_swap[i].kpage, true);
+    swap_cnt++;
+  }
+
+  cond_broadcast (&eviction_done, &frame_lock);
+  return evicted;
+}
+
+/**
+ * Looks up the frame of the current thread at `kpage`, waiting for
+ * its eviction to finish if it is being evicted.
+ * Returns NULL if there is no such frame (anymore).
+ * MUST BE CALLED with 'frame_lock' held.
+ */
+static struct frame_table_entry*
+vm_frame_wait_eviction (void *kpage)
+{
+  ASSERT (lock_held_by_current_thread(&frame_lock) == true);
+
+  struct frame_table_entry *f;
+  while ((f = vm_frame_lookup (kpage)) != NULL && f->evicting)
+    cond_wait (&eviction_done, &frame_lock);
+
+  // the page may have been reused by another thread meanwhile.
+  if (f == NULL || f->t != thread_current ())
+    return NULL;
+  return f;
+}
+
+/**
+ * Returns true if the frame at `kpage` is being evicted; if so,
+ * waits for the eviction to finish first.
+ */
+bool
+vm_frame_wait (void *kpage)
+{
+  lock_acquire (&frame_lock);
+  struct frame_table_entry *f = vm_frame_lookup (kpage);
+  bool evicting = f != NULL && f->evicting;
+  vm_frame_wait_eviction (kpage);
+  lock_release (&frame_lock);
+  return evicting;
+}
+
+/* Returns the frame table entry at `kpage`, or NULL. */
+static struct frame_table_entry*
+vm_frame_lookup (void *kpage)
+{
+  // hash lookup : a temporary entry
+  struct frame_table_entry f_tmp;
+  f_tmp.kpage = kpage;
+
+  struct hash_elem *h = hash_find (&frame_map, &(f_tmp.helem));
+  if (h == NULL) return NULL;
+  return hash_entry(h, struct frame_table_entry, helem);
 }
 
 /**
@@ -162,6 +821,14 @@ vm_frame_do_free (void *kpage, bool free_page)
   f = hash_entry(h, struct frame_table_entry, helem);
 
   hash_delete (&frame_map, &f->helem);
+  if (f->t == NULL) {
+    ASSERT (f->ref_cnt == 0);
+    hash_delete (&page_cache, &f->cache_elem);
+  }
+  if (clock_ptr == &f->lelem)
+    clock_ptr = list_prev (clock_ptr); // keep the clock hands on the list
+  if (front_ptr == &f->lelem)
+    front_ptr = list_prev (front_ptr);
   list_remove (&f->lelem);
 
   // Free resources
@@ -169,74 +836,235 @@ vm_frame_do_free (void *kpage, bool free_page)
   free(f);
 }
 
-/** Frame Eviction Strategy : The Clock Algorithm */
-struct frame_table_entry* clock_frame_next(void);
-struct frame_table_entry* pick_frame_to_evict( uint32_t *pagedir )
+/**
+ * Frame Eviction Strategies.
+ *
+ * Replacement is global: any process's frame may be picked, and its
+ * reference bit is read from its owner's page directory, for both the
+ * user page and its kernel alias (the kernel touches user pages through
+ * the latter, e.g. in read() system calls).
+ */
+
+/* Returns true if E has been referenced since the last call,
+   clearing its reference bits. */
+static bool
+frame_test_and_clear_accessed (struct frame_table_entry *e)
 {
-  size_t n = hash_size(&frame_map);
-  if(n == 0) PANIC("Frame table is empty, can't happen - there is a leak somewhere");
+  if (e->t == NULL) {
+    // a frame of the page cache: referenced by any of its mappings.
+    bool accessed = false;
+    struct list_elem *el;
+    for (el = list_begin (&e->mappings); el != list_end (&e->mappings);
+         el = list_next (el)) {
+      struct frame_mapping *m = list_entry (el, struct frame_mapping, elem);
+      accessed = pagedir_is_accessed (m->t->pagedir, m->spte->upage) || accessed;
+      pagedir_set_accessed (m->t->pagedir, m->spte->upage, false);
+    }
+    return accessed;
+  }
+
+  uint32_t *pagedir = e->t->pagedir;
+  bool accessed = pagedir_is_accessed(pagedir, e->upage)
+    || pagedir_is_accessed(pagedir, e->kpage);
+  pagedir_set_accessed(pagedir, e->kpage, false);
 
+  // a large page has a single reference bit, in its PDE: all of its
+  // frames are referenced while it is set. It is cleared only by the
+  // last of them, which comes last in the frame list, so that the
+  // hands see the same bit on all of them in a pass.
+  if (!pagedir_is_large (pagedir, e->upage)
+      || pg_no (e->upage) % (LPGSIZE / PGSIZE) == LPGSIZE / PGSIZE - 1)
+    pagedir_set_accessed(pagedir, e->upage, false);
+  return accessed;
+}
+
+/* Returns true if E may be evicted now. */
+static inline bool
+frame_evictable (const struct frame_table_entry *e)
+{
+  return !e->pinned && !e->evicting;
+}
+
+struct frame_table_entry* clock_frame_next(struct list_elem **hand);
+
+/* The Clock Algorithm (second chance). */
+static struct frame_table_entry*
+pick_clock (size_t n)
+{
   size_t it;
   for(it = 0; it <= n + n; ++ it) // prevent infinite loop. 2n iterations is enough
   {
-    struct frame_table_entry *e = clock_frame_next();
-    // if pinned, continue
-    if(e->pinned) continue;
+    struct frame_table_entry *e = clock_frame_next(&clock_ptr);
+    // if pinned or already being evicted, continue
+    if(!frame_evictable(e)) continue;
     // if referenced, give a second chance.
-    else if( pagedir_is_accessed(pagedir, e->upage)) {
-      pagedir_set_accessed(pagedir, e->upage, false);
-      continue;
-    }
+    else if(frame_test_and_clear_accessed(e)) continue;
 
     // OK, here is the victim : unreferenced since its last chance
     return e;
   }
+  return NULL;
+}
 
-  PANIC ("Can't evict any frame -- Not enough memory!\n");
+/* The Two-Handed Clock Algorithm: the front hand clears reference
+   bits, and the back hand, a quarter of the frames behind, evicts
+   the first frame not referenced again since. The distance between
+   the hands, rather than a full revolution, bounds how long a page
+   has to prove it is in use. */
+static struct frame_table_entry*
+pick_clock2 (size_t n)
+{
+  size_t spread = n / 4 > 0 ? n / 4 : 1;
+  size_t it;
+
+  if (front_ptr == NULL) {
+    front_ptr = clock_ptr;
+    for (it = 0; it < spread; it++)
+      clock_frame_next(&front_ptr);
+  }
+
+  for(it = 0; it <= n + n + spread; ++ it)
+  {
+    struct frame_table_entry *front = clock_frame_next(&front_ptr);
+    struct frame_table_entry *back = clock_frame_next(&clock_ptr);
+
+    if (front != back)
+      frame_test_and_clear_accessed(front);
+    if(!frame_evictable(back)) continue;
+    else if(frame_test_and_clear_accessed(back)) continue;
+    return back;
+  }
+  return NULL;
 }
-struct frame_table_entry* clock_frame_next(void)
+
+/* An approximation of LRU-2: each eviction (of up to a cluster of
+   frames) ages every frame's 8-bit reference history, then evicts
+   the frame whose second most recent reference is the oldest, so
+   that pages touched only once (e.g. by a sequential scan) go before
+   pages in repeated use. */
+static struct frame_table_entry*
+pick_lru2 (void)
+{
+  struct frame_table_entry *victim = NULL;
+  unsigned victim_key = 0;
+  struct list_elem *el;
+
+  for (el = list_begin (&frame_list); el != list_end (&frame_list);
+       el = list_next (el))
+  {
+    struct frame_table_entry *e = list_entry(el, struct frame_table_entry, lelem);
+    if (!history_aged)
+      e->history = (e->history >> 1)
+        | (frame_test_and_clear_accessed(e) ? 0x80 : 0);
+    if(!frame_evictable(e)) continue;
+
+    // key: history without its most recent reference, then the history
+    unsigned latest = e->history;
+    while (latest & (latest - 1))
+      latest &= latest - 1;
+    unsigned key = ((e->history & ~latest) << 8) | e->history;
+    if (victim == NULL || key < victim_key) {
+      victim = e;
+      victim_key = key;
+    }
+  }
+  history_aged = true;
+  return victim;
+}
+
+struct frame_table_entry* pick_frame_to_evict(void)
+{
+  size_t n = hash_size(&frame_map);
+  if(n == 0) return NULL;
+
+  switch (vm_frame_policy)
+  {
+  case VM_EVICT_CLOCK2:
+    return pick_clock2 (n);
+  case VM_EVICT_LRU2:
+    return pick_lru2 ();
+  case VM_EVICT_CLOCK:
+  default:
+    return pick_clock (n);
+  }
+}
+
+/* Advances the clock hand *HAND, wrapping around the frame list. */
+struct frame_table_entry* clock_frame_next(struct list_elem **hand)
 {
   if (list_empty(&frame_list))
     PANIC("Frame table is empty, can't happen - there is a leak somewhere");
 
-  if (clock_ptr == NULL || clock_ptr == list_end(&frame_list))
-    clock_ptr = list_begin (&frame_list);
+  if (*hand == NULL || *hand == list_end(&frame_list))
+    *hand = list_begin (&frame_list);
   else
-    clock_ptr = list_next (clock_ptr);
+    *hand = list_next (*hand);
+  if (*hand == list_end(&frame_list))
+    *hand = list_begin (&frame_list);
 
-  struct frame_table_entry *e = list_entry(clock_ptr, struct frame_table_entry, lelem);
+  struct frame_table_entry *e = list_entry(*hand, struct frame_table_entry, lelem);
   return e;
 }
 
 
-static void
+/**
+ * Pins or unpins the current thread's frame at `kpage`, waiting for
+ * it to be evicted first if it is being evicted.
+ * Returns false if the frame is not (or no longer) in memory.
+ */
+static bool
 vm_frame_set_pinned (void *kpage, bool new_value)
 {
   lock_acquire (&frame_lock);
 
-  // hash lookup : a temporary entry
-  struct frame_table_entry f_tmp;
-  f_tmp.kpage = kpage;
-  struct hash_elem *h = hash_find (&frame_map, &(f_tmp.helem));
-  if (h == NULL) {
-    PANIC ("The frame to be pinned/unpinned does not exist");
+  struct frame_table_entry *f = vm_frame_lookup (kpage);
+  if (f != NULL && f->t == NULL) {
+    // a frame of the page cache, which several processes may pin;
+    // it must still be mapped by the current one.
+    if (frame_find_mapping (f, thread_current ()) == NULL)
+      f = NULL;
+    else if (new_value)
+      f->pin_cnt++;
+    else {
+      ASSERT (f->pin_cnt > 0);
+      f->pin_cnt--;
+    }
+    if (f != NULL)
+      f->pinned = f->pin_cnt > 0;
+  }
+  else {
+    f = vm_frame_wait_eviction (kpage);
+    if (f != NULL)
+      f->pinned = new_value;
   }
-
-  struct frame_table_entry *f;
-  f = hash_entry(h, struct frame_table_entry, helem);
-  f->pinned = new_value;
 
   lock_release (&frame_lock);
+  return f != NULL;
 }
 
-void
+bool
 vm_frame_unpin (void* kpage) {
-  vm_frame_set_pinned (kpage, false);
+  return vm_frame_set_pinned (kpage, false);
 }
 
-void
+bool
 vm_frame_pin (void* kpage) {
-  vm_frame_set_pinned (kpage, true);
+  return vm_frame_set_pinned (kpage, true);
+}
+
+/* Print frame allocation and eviction statistics. */
+void
+vm_frame_print_stats (void)
+{
+  static const char *policy_names[] = {"clock", "clock2", "lru2"};
+  printf ("Frames: %llu allocated, %llu paged out, %llu direct evictions "
+          "(free pages low %zu, high %zu, %s policy)\n",
+          alloc_cnt, pageout_cnt, direct_cnt, low_water, high_water,
+          policy_names[vm_frame_policy]);
+  printf ("Evicted pages: %llu dropped clean, %llu written to file, "
+          "%llu written to swap\n", drop_cnt, writeback_cnt, swap_cnt);
+  printf ("Page cache: %llu frames shared, %llu read in, %llu copied on write\n",
+          cache_hit_cnt, cache_miss_cnt, cow_cnt);
 }
 
 
@@ -254,3 +1082,21 @@ static bool frame_less_func(const struct hash_elem *a, const struct hash_elem *b
   struct frame_table_entry *b_entry = hash_entry(b, struct frame_table_entry, helem);
   return a_entry->kpage < b_entry->kpage;
 }
+
+// Hash Functions required for [page_cache]. Uses (inode, offset, read_bytes) as key.
+static unsigned cache_hash_func(const struct hash_elem *elem, void *aux UNUSED)
+{
+  struct frame_table_entry *entry = hash_entry(elem, struct frame_table_entry, cache_elem);
+  return hash_bytes( &entry->inode, sizeof entry->inode )
+    ^ hash_int( entry->offset ) ^ hash_int( entry->read_bytes );
+}
+static bool cache_less_func(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED)
+{
+  struct frame_table_entry *a_entry = hash_entry(a, struct frame_table_entry, cache_elem);
+  struct frame_table_entry *b_entry = hash_entry(b, struct frame_table_entry, cache_elem);
+  if (a_entry->inode != b_entry->inode)
+    return a_entry->inode < b_entry->inode;
+  if (a_entry->offset != b_entry->offset)
+    return a_entry->offset < b_entry->offset;
+  return a_entry->read_bytes < b_entry->read_bytes;
+}
@@ -11,12 +11,38 @@
 /* Functions for Frame manipulation. */
 
 void vm_frame_init (void);
+void vm_frame_init_pageout (void);
 void* vm_frame_allocate (enum palloc_flags flags, void *upage);
+void* vm_frame_allocate_large (void *upage);
 
 void vm_frame_free (void*);
-void vm_frame_remove_entry (void*);
-
-void vm_frame_pin (void* kpage);
-void vm_frame_unpin (void* kpage);
+void vm_frame_free_multiple (void *kpages[], size_t cnt);
+void vm_frame_release_all (uint32_t *pagedir);
+
+bool vm_frame_pin (void* kpage);
+bool vm_frame_unpin (void* kpage);
+bool vm_frame_wait (void* kpage);
+
+struct supplemental_page_table_entry;
+void vm_frame_pin_multiple (struct supplemental_page_table_entry *sptes[], size_t cnt);
+bool vm_frame_get_shared (struct supplemental_page_table_entry *, uint32_t *pagedir);
+bool vm_frame_copy_shared (struct supplemental_page_table_entry *, uint32_t *pagedir,
+    void *kpage);
+bool vm_frame_write_fault_ok (struct supplemental_page_table_entry *,
+    uint32_t *pagedir);
+
+void vm_frame_print_stats (void);
+
+/* Low watermark of free user pages for the page-out daemon. */
+extern int vm_frame_low_water;
+
+/* Page replacement policies. */
+enum vm_evict_policy
+  {
+    VM_EVICT_CLOCK,             /* Clock (second chance). */
+    VM_EVICT_CLOCK2,            /* Two-handed clock. */
+    VM_EVICT_LRU2               /* Approximated LRU-2. */
+  };
+extern enum vm_evict_policy vm_frame_policy;
 
 #endif /* vm/frame.h */
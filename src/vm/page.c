@@ -1,16 +1,25 @@
 #include <hash.h>
+#include <round.h>
+#include <stdio.h>
 #include <string.h>
 #include "lib/kernel/hash.h"
 
+#include "threads/init.h"
 #include "threads/synch.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
 #include "vm/page.h"
 #include "vm/frame.h"
 #include "filesys/file.h"
 
+/* Pages unmapped, and swap slots freed, at a time. */
+#define UNMAP_BATCH 32
+#define DESTROY_BATCH 64
+
 static unsigned spte_hash_func(const struct hash_elem *elem, void *aux);
 static bool     spte_less_func(const struct hash_elem *, const struct hash_elem *, void *aux);
 static void     spte_destroy_func(struct hash_elem *elem, void *aux);
@@ -23,6 +32,10 @@ vm_supt_create (void)
     (struct supplemental_page_table*) malloc(sizeof(struct supplemental_page_table));
 
   hash_init (&supt->page_map, spte_hash_func, spte_less_func, NULL);
+  supt->last_fault = NULL;
+  supt->around_start = NULL;
+  supt->around_cnt = 0;
+  supt->around_window = 0;
   return supt;
 }
 
@@ -31,6 +44,46 @@ vm_supt_destroy (struct supplemental_page_table *supt)
 {
   ASSERT (supt != NULL);
 
+  // (the page table of the exiting current process)
+  uint32_t *pagedir = thread_current ()->pagedir;
+
+  // release all the frames at once; the pages evicted meanwhile are
+  // on swap afterwards.
+  vm_frame_release_all (pagedir);
+
+  // then the swap slots, in bulk.
+  swap_index_t swap_indexes[DESTROY_BATCH];
+  zswap_index_t zswap_indexes[DESTROY_BATCH];
+  size_t swap_cnt = 0, zswap_cnt = 0;
+  struct hash_iterator i;
+
+  hash_first (&i, &supt->page_map);
+  while (hash_next (&i)) {
+    struct supplemental_page_table_entry *spte =
+      hash_entry (hash_cur (&i), struct supplemental_page_table_entry, elem);
+
+    if (spte->status == ON_SWAP) {
+      swap_indexes[swap_cnt++] = spte->swap_index;
+      if (swap_cnt == DESTROY_BATCH) {
+        vm_swap_free_multiple (swap_indexes, swap_cnt);
+        swap_cnt = 0;
+      }
+    }
+    else if (spte->status == ON_ZSWAP) {
+      zswap_indexes[zswap_cnt++] = spte->zswap_index;
+      if (zswap_cnt == DESTROY_BATCH) {
+        vm_zswap_free_multiple (zswap_indexes, zswap_cnt);
+        zswap_cnt = 0;
+      }
+    }
+    else if (spte->status == ON_ZERO_FRAME && pagedir != NULL) {
+      // not to be freed along with the page directory.
+      pagedir_clear_page (pagedir, spte->upage);
+    }
+  }
+  vm_swap_free_multiple (swap_indexes, swap_cnt);
+  vm_zswap_free_multiple (zswap_indexes, zswap_cnt);
+
   hash_destroy (&supt->page_map, spte_destroy_func);
   free (supt);
 }
@@ -54,6 +107,8 @@ vm_supt_install_frame (struct supplemental_page_table *supt, void *upage, void *
   spte->status = ON_FRAME;
   spte->dirty = false;
   spte->swap_index = -1;
+  spte->file = NULL;
+  spte->shared = false;
 
   struct hash_elem *prev_elem;
   prev_elem = hash_insert (&supt->page_map, &spte->elem);
@@ -83,6 +138,8 @@ vm_supt_install_zeropage (struct supplemental_page_table *supt, void *upage)
   spte->kpage = NULL;
   spte->status = ALL_ZERO;
   spte->dirty = false;
+  spte->file = NULL;
+  spte->shared = false;
 
   struct hash_elem *prev_elem;
   prev_elem = hash_insert (&supt->page_map, &spte->elem);
@@ -110,14 +167,52 @@ vm_supt_set_swap (struct supplemental_page_table *supt, void *page, swap_index_t
   return true;
 }
 
+/**
+ * Mark an existent page to be swapped out to the compressed swap,
+ * and update zswap_index in the SPTE.
+ */
+bool
+vm_supt_set_zswap (struct supplemental_page_table *supt, void *page, zswap_index_t zswap_index)
+{
+  struct supplemental_page_table_entry *spte;
+  spte = vm_supt_lookup(supt, page);
+  if(spte == NULL) return false;
+
+  spte->status = ON_ZSWAP;
+  spte->kpage = NULL;
+  spte->zswap_index = zswap_index;
+  return true;
+}
+
+/**
+ * Mark an existent page, unmodified since it was read from its file
+ * (or just written back to it), to be read from the file again.
+ */
+bool
+vm_supt_set_filesys (struct supplemental_page_table *supt, void *page)
+{
+  struct supplemental_page_table_entry *spte;
+  spte = vm_supt_lookup(supt, page);
+  if(spte == NULL) return false;
+
+  ASSERT (spte->file != NULL);
+  spte->status = FROM_FILESYS;
+  spte->kpage = NULL;
+  spte->dirty = false;
+  return true;
+}
+
 
 /**
  * Install a new page (specified by the starting address `upage`)
  * on the supplemental page table, of type FROM_FILESYS.
+ * Changes to a `shared` page are written back to the file (mmap);
+ * otherwise they are private to the process.
  */
 bool
 vm_supt_install_filesys (struct supplemental_page_table *supt, void *upage,
-    struct file * file, off_t offset, uint32_t read_bytes, uint32_t zero_bytes, bool writable)
+    struct file * file, off_t offset, uint32_t read_bytes, uint32_t zero_bytes, bool writable,
+    bool shared)
 {
   struct supplemental_page_table_entry *spte;
   spte = (struct supplemental_page_table_entry *) malloc(sizeof(struct supplemental_page_table_entry));
@@ -131,6 +226,7 @@ vm_supt_install_filesys (struct supplemental_page_table *supt, void *upage,
   spte->read_bytes = read_bytes;
   spte->zero_bytes = zero_bytes;
   spte->writable = writable;
+  spte->shared = shared;
 
   struct hash_elem *prev_elem;
   prev_elem = hash_insert (&supt->page_map, &spte->elem);
@@ -182,12 +278,46 @@ vm_supt_set_dirty (struct supplemental_page_table *supt, void *page, bool value)
 }
 
 static bool vm_load_page_from_filesys(struct supplemental_page_table_entry *, void *);
+static void vm_fault_around(struct supplemental_page_table *, uint32_t *, void *);
+static bool vm_load_large_page(struct supplemental_page_table *, uint32_t *, void *);
+
+size_t vm_fault_around_max = VM_FAULT_AROUND_MAX;
+bool vm_large_pages;
+
+// the page of zeros which ALL_ZERO pages are mapped to, read-only,
+// until they are first written.
+static void *zero_frame;
+
+// statistics
+static unsigned long long around_cnt, around_used_cnt;
+static unsigned long long zero_map_cnt, zero_copy_cnt;
+static unsigned long long large_cnt;
+
+void
+vm_page_init (void)
+{
+  zero_frame = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+}
+
+/* Returns true if the page of SPTE, not in memory, is to be mapped to
+   the page cache for an access, which is a write if WRITE: private
+   pages of files (executables) are, until they are written to. */
+static bool
+page_shareable (struct supplemental_page_table_entry *spte, bool write)
+{
+  return spte->status == FROM_FILESYS && spte->file != NULL && !spte->shared
+    && (!write || !spte->writable);
+}
 
 /**
- * Load the page, specified by the address `upage`, back into the memory.
+ * Load the page, specified by the address `upage`, back into the memory,
+ * for reading only unless `write`: an ALL_ZERO page is then mapped to
+ * the shared zero frame, and a private page of a file to the page cache,
+ * and they get a frame of their own on the first write (copy-on-write).
  */
 bool
-vm_load_page(struct supplemental_page_table *supt, uint32_t *pagedir, void *upage)
+vm_load_page(struct supplemental_page_table *supt, uint32_t *pagedir, void *upage,
+    bool write)
 {
   /* see also userprog/exception.c */
 
@@ -198,8 +328,46 @@ vm_load_page(struct supplemental_page_table *supt, uint32_t *pagedir, void *upag
     return false;
   }
 
-  if(spte->status == ON_FRAME) {
-    // already loaded
+  while (spte->status == ON_FRAME) {
+    // already loaded, unless the page-out daemon is evicting it:
+    // then it has been unmapped, and we wait for it to reach swap.
+    void *kpage = spte->kpage;
+    if (kpage == NULL || pagedir_get_page (pagedir, upage) != NULL
+        || !vm_frame_wait (kpage))
+      return true;
+  }
+
+  // the whole large page around it, if it is to be mapped with one.
+  if (vm_large_pages && vm_load_large_page (supt, pagedir, upage))
+    return true;
+
+  if (spte->status == ON_ZERO_FRAME) {
+    if (!write)
+      return true;
+    // the first write: replace the zero frame with a private frame.
+    pagedir_clear_page (pagedir, upage);
+    spte->status = ALL_ZERO;
+    zero_copy_cnt++;
+  }
+  else if (spte->status == ALL_ZERO && !write) {
+    if (!pagedir_set_page (pagedir, upage, zero_frame, false))
+      return false;
+    spte->status = ON_ZERO_FRAME;
+    zero_map_cnt++;
+    return true;
+  }
+
+  else if (spte->status == ON_SHARED && (!write || !spte->writable)) {
+    return true;
+  }
+  else if (page_shareable (spte, write)) {
+    if (!vm_frame_get_shared (spte, pagedir))
+      return false;
+    // as below: it may be evicted, but not to make room for the others.
+    if (vm_frame_pin (spte->kpage)) {
+      vm_fault_around (supt, pagedir, upage);
+      vm_unpin_page (supt, upage);
+    }
     return true;
   }
 
@@ -226,6 +394,21 @@ vm_load_page(struct supplemental_page_table *supt, uint32_t *pagedir, void *upag
     vm_swap_in (spte->swap_index, frame_page);
     break;
 
+  case ON_ZSWAP:
+    vm_zswap_in (spte->zswap_index, frame_page);
+    break;
+
+  case ON_SHARED:
+    // copy-on-write: the first write to a private page of a file.
+    if (vm_frame_copy_shared (spte, pagedir, frame_page))
+      break;
+    // evicted from the page cache meanwhile: read it from the file.
+    if( vm_load_page_from_filesys(spte, frame_page) == false) {
+      vm_frame_free(frame_page);
+      return false;
+    }
+    break;
+
   case FROM_FILESYS:
     if( vm_load_page_from_filesys(spte, frame_page) == false) {
       vm_frame_free(frame_page);
@@ -251,80 +434,303 @@ vm_load_page(struct supplemental_page_table *supt, uint32_t *pagedir, void *upag
 
   pagedir_set_dirty (pagedir, frame_page, false);
 
+  // bring in the following pages too, keeping this one pinned meanwhile
+  // so that it cannot be chosen to make room for them.
+  vm_fault_around (supt, pagedir, upage);
+
   // unpin frame
   vm_frame_unpin(frame_page);
 
   return true;
 }
 
-bool
-vm_supt_mm_unmap(
-    struct supplemental_page_table *supt, uint32_t *pagedir,
-    void *page, struct file *f, off_t offset, size_t bytes)
+/**
+ * Large pages (-lp): loads the `LPGSIZE` bytes of memory around `upage`,
+ * aligned, all at once and maps them with a single large page, which
+ * takes one TLB entry instead of 1,024.  They must all be anonymous
+ * pages which were never loaded, or pages of a single memory-mapped
+ * file which are not in memory, and there must be free memory for them,
+ * contiguous and aligned.  Returns false otherwise.
+ *
+ * The frames are those of 4 kB pages as far as the frame table is
+ * concerned: evicting or unmapping one of them splits the large page
+ * first (see userprog/pagedir.c).
+ */
+static bool
+vm_load_large_page(struct supplemental_page_table *supt, uint32_t *pagedir, void *upage)
 {
-  struct supplemental_page_table_entry *spte = vm_supt_lookup(supt, page);
-  if(spte == NULL) {
-    PANIC ("munmap - some page is missing; can't happen!");
+  const size_t cnt = LPGSIZE / PGSIZE;
+  uint8_t *base = (uint8_t *) ((uintptr_t) upage & ~(uintptr_t) (LPGSIZE - 1));
+  struct supplemental_page_table_entry *first, *spte;
+  uint32_t read_bytes = 0;
+  size_t i;
+
+  if (!init_large_pages)
+    return false;
+  first = vm_supt_lookup (supt, base);
+  if (first == NULL || !(first->status == ALL_ZERO
+                         || (first->status == FROM_FILESYS && first->shared)))
+    return false;
+  for (i = 0; i < cnt; i++) {
+    spte = vm_supt_lookup (supt, base + i * PGSIZE);
+    if (spte == NULL || spte->status != first->status)
+      return false;
+    if (spte->status == FROM_FILESYS) {
+      // a single mapping: consecutive pages of the file, partial
+      // only at the end of the file.
+      if (spte->file != first->file || !spte->shared || !spte->writable
+          || spte->file_offset != first->file_offset + (off_t) (i * PGSIZE)
+          || read_bytes != i * PGSIZE)
+        return false;
+      read_bytes += spte->read_bytes;
+    }
   }
 
-  // Pin the associated frame if loaded
-  // otherwise, a page fault could occur while swapping in (reading the swap disk)
-  if (spte->status == ON_FRAME) {
-    ASSERT (spte->kpage != NULL);
-    vm_frame_pin (spte->kpage);
+  uint8_t *kpage = vm_frame_allocate_large (base);
+  if (kpage == NULL)
+    return false;
+
+  if (first->status == FROM_FILESYS) {
+    if (file_read_at (first->file, kpage, read_bytes, first->file_offset)
+        != (off_t) read_bytes)
+      goto fail;
+    memset (kpage + read_bytes, 0, LPGSIZE - read_bytes);
   }
+  else
+    memset (kpage, 0, LPGSIZE);
 
+  if (!pagedir_set_large_page (pagedir, base, kpage, true))
+    goto fail;
 
-  // see also, vm_load_page()
-  switch (spte->status)
-  {
-  case ON_FRAME:
-    ASSERT (spte->kpage != NULL);
-
-    // Dirty frame handling (write into file)
-    // Check if the upage or mapped frame is dirty. If so, write to file.
-    bool is_dirty = spte->dirty;
-    is_dirty = is_dirty || pagedir_is_dirty(pagedir, spte->upage);
-    is_dirty = is_dirty || pagedir_is_dirty(pagedir, spte->kpage);
-    if(is_dirty) {
-      file_write_at (f, spte->upage, bytes, offset);
+  for (i = 0; i < cnt; i++) {
+    spte = vm_supt_lookup (supt, base + i * PGSIZE);
+    spte->kpage = kpage + i * PGSIZE;
+    spte->status = ON_FRAME;
+    pagedir_set_dirty (pagedir, spte->kpage, false);
+    vm_frame_unpin (spte->kpage);
+  }
+  large_cnt++;
+  return true;
+
+ fail:
+  for (i = 0; i < cnt; i++)
+    vm_frame_free (kpage + i * PGSIZE);
+  return false;
+}
+
+/**
+ * Fault-around: after a fault on `upage`, bring in the non-resident
+ * pages right after it as well, so that a process going through its
+ * memory sequentially takes one fault every few pages.  Pages in
+ * contiguous swap slots are read with a single request.
+ *
+ * The window is adaptive, per process: it doubles (up to
+ * vm_fault_around_max) when all the pages brought in around the previous
+ * fault have been accessed by the time of the next fault, halves when
+ * fewer than half of them have, and once at zero, it is re-opened by
+ * two faults on consecutive pages.
+ */
+static void
+vm_fault_around(struct supplemental_page_table *supt, uint32_t *pagedir, void *upage)
+{
+  struct supplemental_page_table_entry *sptes[VM_FAULT_AROUND_MAX];
+  void *kpages[VM_FAULT_AROUND_MAX];
+  size_t i, n, used = 0;
+
+  // how useful was the previous fault-around?
+  for (i = 0; i < supt->around_cnt; i++)
+    if (pagedir_is_accessed (pagedir, supt->around_start + i * PGSIZE))
+      used++;
+  around_used_cnt += used;
+
+  if (supt->around_cnt > 0 && used * 2 < supt->around_cnt)
+    supt->around_window /= 2;
+  else if (supt->around_cnt > 0 && used == supt->around_cnt)
+    supt->around_window *= 2;
+  else if (supt->around_window == 0 && upage == supt->last_fault + PGSIZE)
+    supt->around_window = 1;
+  if (supt->around_window > vm_fault_around_max)
+    supt->around_window = vm_fault_around_max;
+
+  supt->last_fault = upage;
+  supt->around_start = upage + PGSIZE;
+  supt->around_cnt = 0;
+
+  // do not reclaim memory for pages which may not be needed.
+  size_t window = supt->around_window;
+  if (window > palloc_free_cnt (PAL_USER) / 2)
+    window = palloc_free_cnt (PAL_USER) / 2;
+
+  // the run of pages to read: stop at the first resident (or missing,
+  // or all-zero) page. Those of the page cache are mapped right away.
+  size_t covered, shared_cnt = 0;
+  for (covered = 0, n = 0; covered < window; covered++) {
+    void *page = upage + (covered + 1) * PGSIZE;
+    if (!is_user_vaddr (page))
+      break;
+    struct supplemental_page_table_entry *spte = vm_supt_lookup (supt, page);
+    if (spte == NULL || (spte->status != ON_SWAP && spte->status != ON_ZSWAP
+                         && spte->status != FROM_FILESYS))
+      break;
+    if (page_shareable (spte, false)) {
+      if (!vm_frame_get_shared (spte, pagedir))
+        break;
+      pagedir_set_accessed (pagedir, page, false);
+      shared_cnt++;
+      continue;
     }
+    kpages[n] = vm_frame_allocate (PAL_USER, page);
+    if (kpages[n] == NULL)
+      break;
+    sptes[n++] = spte;
+  }
 
-    // clear the page mapping, and release the frame
-    vm_frame_free (spte->kpage);
-    pagedir_clear_page (pagedir, spte->upage);
-    break;
+  // map the pages first: the data can then no longer be lost to a
+  // failure once read from swap (which frees the slots).
+  size_t mapped;
+  for (mapped = 0; mapped < n; mapped++) {
+    struct supplemental_page_table_entry *spte = sptes[mapped];
+    bool writable = spte->status != FROM_FILESYS || spte->writable;
+    if (!pagedir_set_page (pagedir, spte->upage, kpages[mapped], writable))
+      break;
+  }
+  for (i = mapped; i < n; i++)
+    vm_frame_free (kpages[i]);
+  n = mapped;
+
+  // fetch the data, in as few requests as possible.
+  for (i = 0; i < n; ) {
+    size_t run = 1;
+    if (sptes[i]->status == ON_SWAP) {
+      while (i + run < n && sptes[i + run]->status == ON_SWAP
+             && sptes[i + run]->swap_index == sptes[i]->swap_index + run)
+        run++;
+      vm_swap_in_multiple (sptes[i]->swap_index, run, kpages + i);
+    }
+    else if (sptes[i]->status == ON_ZSWAP)
+      vm_zswap_in (sptes[i]->zswap_index, kpages[i]);
+    else if (!vm_load_page_from_filesys (sptes[i], kpages[i]))
+      break;
+    i += run;
+  }
+  for (mapped = i; i < n; i++) {
+    pagedir_clear_page (pagedir, sptes[i]->upage);
+    vm_frame_free (kpages[i]);
+  }
 
-  case ON_SWAP:
-    {
-      bool is_dirty = spte->dirty;
-      is_dirty = is_dirty || pagedir_is_dirty(pagedir, spte->upage);
-      if (is_dirty) {
-        // load from swap, and write back to file
-        void *tmp_page = palloc_get_page(0); // in the kernel
-        vm_swap_in (spte->swap_index, tmp_page);
-        file_write_at (f, tmp_page, PGSIZE, offset);
-        palloc_free_page(tmp_page);
+  // with the accessed bit clear, to see at the next fault whether
+  // they were worth it.
+  for (i = 0; i < mapped; i++) {
+    sptes[i]->kpage = kpages[i];
+    sptes[i]->status = ON_FRAME;
+    pagedir_set_dirty (pagedir, kpages[i], false);
+    pagedir_set_accessed (pagedir, sptes[i]->upage, false);
+    vm_frame_unpin (kpages[i]);
+  }
+
+  supt->around_cnt = covered;
+  around_cnt += shared_cnt + mapped;
+}
+
+/* Print fault-around and zero frame statistics. */
+void
+vm_page_print_stats (void)
+{
+  printf ("Fault-around: %llu pages brought in, %llu used\n",
+          around_cnt, around_used_cnt);
+  printf ("Zero frame: %llu pages mapped, %llu written to\n",
+          zero_map_cnt, zero_copy_cnt);
+  printf ("Large pages: %llu mapped, %llu split\n",
+          large_cnt, pagedir_demote_cnt);
+}
+
+/**
+ * Unmap the `size` bytes of the file `f` memory-mapped at `addr`:
+ * the dirty pages are written back to the file, and the pages removed
+ * from the supplemental page table.
+ */
+bool
+vm_supt_mm_unmap(
+    struct supplemental_page_table *supt, uint32_t *pagedir,
+    void *addr, struct file *f, size_t size)
+{
+  struct supplemental_page_table_entry *sptes[UNMAP_BATCH];
+  bool dirty[UNMAP_BATCH];
+  void *kpages[UNMAP_BATCH];
+  size_t offset;
+
+  // a batch of pages at a time.
+  for (offset = 0; offset < size; offset += UNMAP_BATCH * PGSIZE) {
+    size_t bytes = size - offset;
+    if (bytes > UNMAP_BATCH * PGSIZE) bytes = UNMAP_BATCH * PGSIZE;
+    size_t i, j, cnt = DIV_ROUND_UP (bytes, PGSIZE);
+
+    for (i = 0; i < cnt; i++) {
+      sptes[i] = vm_supt_lookup(supt, addr + offset + i * PGSIZE);
+      if(sptes[i] == NULL) {
+        PANIC ("munmap - some page is missing; can't happen!");
       }
-      else {
-        // just throw away the swap.
-        vm_swap_free (spte->swap_index);
+    }
+
+    // Pin the frames of the pages which are loaded, all at once, so
+    // that they stay until written back. The pages evicted before we
+    // could pin them have been written back to the file already.
+    vm_frame_pin_multiple (sptes, cnt);
+
+    // Check if the upage or mapped frame is dirty.
+    for (i = 0; i < cnt; i++) {
+      struct supplemental_page_table_entry *spte = sptes[i];
+      dirty[i] = false;
+      if (spte->status == ON_FRAME) {
+        dirty[i] = spte->dirty;
+        dirty[i] = dirty[i] || pagedir_is_dirty(pagedir, spte->upage);
+        dirty[i] = dirty[i] || pagedir_is_dirty(pagedir, spte->kpage);
       }
     }
-    break;
 
-  case FROM_FILESYS:
-    // do nothing.
-    break;
+    // Write the runs of dirty pages back to the file, in file offset
+    // order, each with a single (multi-sector) write.
+    for (i = 0; i < cnt; i = j) {
+      for (j = i + 1; j < cnt && dirty[i] && dirty[j]; j++)
+        continue;
+      if (dirty[i]) {
+        off_t ofs = offset + i * PGSIZE;
+        size_t run_bytes = (j - i) * PGSIZE;
+        if (run_bytes > size - ofs) run_bytes = size - ofs;
+        file_write_at (f, sptes[i]->upage, run_bytes, ofs);
+      }
+    }
 
-  default:
-    // Impossible, such as ALL_ZERO
-    PANIC ("unreachable state");
+    // clear the page mappings, and release the frames all at once.
+    size_t frame_cnt = 0;
+    for (i = 0; i < cnt; i++) {
+      struct supplemental_page_table_entry *spte = sptes[i];
+      switch (spte->status)
+      {
+      case ON_FRAME:
+        ASSERT (spte->kpage != NULL);
+        pagedir_clear_page (pagedir, spte->upage);
+        kpages[frame_cnt++] = spte->kpage;
+        break;
+
+      case FROM_FILESYS:
+        // do nothing.
+        break;
+
+      default:
+        // Impossible, such as ALL_ZERO; and pages of memory-mapped
+        // files are written back to the file on eviction, never to swap.
+        PANIC ("unreachable state");
+      }
+
+      // the supplemental page table entry is also removed.
+      // so that the unmapped memory is unreachable. Later access will fault.
+      hash_delete(& supt->page_map, &spte->elem);
+      free (spte);
+    }
+    vm_frame_free_multiple (kpages, frame_cnt);
   }
 
-  // the supplemental page table entry is also removed.
-  // so that the unmapped memory is unreachable. Later access will fault.
-  hash_delete(& supt->page_map, &spte->elem);
   return true;
 }
 
@@ -345,19 +751,32 @@ static bool vm_load_page_from_filesys(struct supplemental_page_table_entry *spte
 }
 
 
-/** Pin the page. */
-void
+/**
+ * Pin the page, loading it first if needed.
+ * Returns false if it could not be loaded.
+ */
+bool
 vm_pin_page(struct supplemental_page_table *supt, void *page)
 {
   struct supplemental_page_table_entry *spte;
   spte = vm_supt_lookup(supt, page);
   if(spte == NULL) {
     // ignore. stack may be grow
-    return;
+    return true;
   }
 
-  ASSERT (spte->status == ON_FRAME);
-  vm_frame_pin (spte->kpage);
+  // the page may get evicted before we pin it; then load it again.
+  while (true) {
+    void *kpage = spte->kpage;
+    if (spte->status == ON_FRAME && kpage != NULL && vm_frame_pin (kpage))
+      return true;
+    // read-only pages stay in the page cache.
+    if (spte->status == ON_SHARED && !spte->writable && kpage != NULL
+        && vm_frame_pin (kpage))
+      return true;
+    if (!vm_load_page (supt, thread_current ()->pagedir, page, true))
+      return false;
+  }
 }
 
 /** Unpin the page. */
@@ -368,7 +787,7 @@ vm_unpin_page(struct supplemental_page_table *supt, void *page)
   spte = vm_supt_lookup(supt, page);
   if(spte == NULL) PANIC ("request page is non-existent");
 
-  if (spte->status == ON_FRAME) {
+  if (spte->status == ON_FRAME || spte->status == ON_SHARED) {
     vm_frame_unpin (spte->kpage);
   }
 }
@@ -395,15 +814,6 @@ spte_destroy_func(struct hash_elem *elem, void *aux UNUSED)
 {
   struct supplemental_page_table_entry *entry = hash_entry(elem, struct supplemental_page_table_entry, elem);
 
-  // Clean up the associated frame
-  if (entry->kpage != NULL) {
-    ASSERT (entry->status == ON_FRAME);
-    vm_frame_remove_entry (entry->kpage);
-  }
-  else if(entry->status == ON_SWAP) {
-    vm_swap_free (entry->swap_index);
-  }
-
-  // Clean up SPTE entry.
+  // its frame and swap slot are gone already: see vm_supt_destroy().
   free (entry);
 }
@@ -2,6 +2,7 @@
 #define VM_PAGE_H
 
 #include "vm/swap.h"
+#include "vm/zswap.h"
 #include <hash.h>
 #include "filesys/off_t.h"
 
@@ -12,6 +13,9 @@ enum page_status {
   ALL_ZERO,         // All zeros
   ON_FRAME,         // Actively in memory
   ON_SWAP,          // Swapped (on swap slot)
+  ON_ZSWAP,         // Swapped, compressed in memory
+  ON_ZERO_FRAME,    // All zeros, mapped read-only to the shared zero frame
+  ON_SHARED,        // Private page of a file, mapped read-only to the page cache
   FROM_FILESYS      // from filesystem (or executable)
 };
 
@@ -22,13 +26,20 @@ struct supplemental_page_table
   {
     /* The hash table, page -> spte */
     struct hash page_map;
+
+    /* Fault-around state: see vm_load_page(). */
+    void *last_fault;         /* Page of the last fault. */
+    void *around_start;       /* First page brought in around it, */
+    size_t around_cnt;        /* and how many. */
+    size_t around_window;     /* Pages to bring in around the next fault. */
   };
 
 struct supplemental_page_table_entry
   {
     void *upage;              /* Virtual address of the page (the key) */
     void *kpage;              /* Kernel page (frame) associated to it.
-                                 Only effective when status == ON_FRAME.
+                                 Only effective when status == ON_FRAME
+                                 or ON_SHARED.
                                  If the page is not on the frame, should be NULL. */
     struct hash_elem elem;
 
@@ -40,11 +51,17 @@ struct supplemental_page_table_entry
     swap_index_t swap_index;  /* Stores the swap index if the page is swapped out.
                                  Only effective when status == ON_SWAP */
 
-    // for FROM_FILESYS
+    // for ON_ZSWAP
+    zswap_index_t zswap_index; /* Where the page is in the compressed swap.
+                                  Only effective when status == ON_ZSWAP */
+
+    // for FROM_FILESYS (kept while ON_FRAME or ON_SWAP: NULL for anonymous pages)
     struct file *file;
     off_t file_offset;
     uint32_t read_bytes, zero_bytes;
     bool writable;
+    bool shared;              /* Memory-mapped file: changes go to the file.
+                                 Otherwise (executables), they go to swap. */
   };
 
 
@@ -58,20 +75,35 @@ void vm_supt_destroy (struct supplemental_page_table *);
 bool vm_supt_install_frame (struct supplemental_page_table *supt, void *upage, void *kpage);
 bool vm_supt_install_zeropage (struct supplemental_page_table *supt, void *);
 bool vm_supt_set_swap (struct supplemental_page_table *supt, void *, swap_index_t);
+bool vm_supt_set_zswap (struct supplemental_page_table *supt, void *, zswap_index_t);
 bool vm_supt_install_filesys (struct supplemental_page_table *supt, void *page,
-    struct file * file, off_t offset, uint32_t read_bytes, uint32_t zero_bytes, bool writable);
+    struct file * file, off_t offset, uint32_t read_bytes, uint32_t zero_bytes, bool writable,
+    bool shared);
+bool vm_supt_set_filesys (struct supplemental_page_table *supt, void *);
 
 struct supplemental_page_table_entry* vm_supt_lookup (struct supplemental_page_table *supt, void *);
 bool vm_supt_has_entry (struct supplemental_page_table *, void *page);
 
 bool vm_supt_set_dirty (struct supplemental_page_table *supt, void *, bool);
 
-bool vm_load_page(struct supplemental_page_table *supt, uint32_t *pagedir, void *upage);
+void vm_page_init (void);
+
+bool vm_load_page(struct supplemental_page_table *supt, uint32_t *pagedir, void *upage,
+    bool write);
+
+/* Maximum number of pages brought in around a fault (0: off). */
+#define VM_FAULT_AROUND_MAX SWAP_CLUSTER
+extern size_t vm_fault_around_max;
+
+/* Map aligned 4 MB of user memory with large pages? */
+extern bool vm_large_pages;
+
+void vm_page_print_stats (void);
 
 bool vm_supt_mm_unmap(struct supplemental_page_table *supt, uint32_t *pagedir,
-    void *page, struct file *f, off_t offset, size_t bytes);
+    void *addr, struct file *f, size_t size);
 
-void vm_pin_page(struct supplemental_page_table *supt, void *page);
+bool vm_pin_page(struct supplemental_page_table *supt, void *page);
 void vm_unpin_page(struct supplemental_page_table *supt, void *page);
 
 #endif
@@ -1,16 +1,48 @@
 #include <bitmap.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 #include "threads/vaddr.h"
 #include "devices/block.h"
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
 #include "vm/swap.h"
 
 static struct block *swap_block;
-static struct bitmap *swap_available;
+
+/* Free swap slots, as a two-level bitmap:
+ * bit i of free_words[w] is set if slot (w * 32 + i) is free, and
+ * bit j of free_summary[s] is set if free_words[s * 32 + j] is nonzero,
+ * so that the words with a free slot are found without looking at the
+ * full ones.  Allocation is next-fit, starting from the word at
+ * `cursor`, and looks at no more than SCAN_WORDS words with a free
+ * slot for a run of the size wanted. */
+#define WORD_BITS 32
+#define SCAN_WORDS 8
+static uint32_t *free_words;
+static uint32_t *free_summary;
+static size_t word_cnt, summary_cnt;
+static size_t cursor;
+
+// protects the free slot bitmap. Pages are swapped out without the frame
+// lock held (see vm_frame_evict()), so several swap-outs may overlap.
+static struct lock swap_lock;
+
+// serializes the use of cluster_buffer.
+static struct lock cluster_lock;
+static uint8_t *cluster_buffer;    /* SWAP_CLUSTER pages */
 
 static const size_t SECTORS_PER_PAGE = PGSIZE / BLOCK_SECTOR_SIZE;
 
 // the number of possible (swapped) pages.
 static size_t swap_size;
 
+// statistics
+static size_t used_cnt, max_used_cnt;
+static unsigned long long out_cnt, out_write_cnt, in_cnt;
+
 void
 vm_swap_init ()
 {
@@ -23,37 +55,186 @@ vm_swap_init ()
     NOT_REACHED ();
   }
 
-  // Initialize swap_available, with all entry true
-  // each single bit of `swap_available` corresponds to a block region,
+  // Initialize the free slot bitmap, with all slots free.
+  // each single slot corresponds to a block region,
   // which consists of contiguous [SECTORS_PER_PAGE] sectors,
   // their total size being equal to PGSIZE.
   swap_size = block_size(swap_block) / SECTORS_PER_PAGE;
-  swap_available = bitmap_create(swap_size);
-  bitmap_set_all(swap_available, true);
+  word_cnt = (swap_size + WORD_BITS - 1) / WORD_BITS;
+  summary_cnt = (word_cnt + WORD_BITS - 1) / WORD_BITS;
+  free_words = calloc (word_cnt, sizeof *free_words);
+  free_summary = calloc (summary_cnt, sizeof *free_summary);
+  if (free_words == NULL || free_summary == NULL)
+    PANIC ("Error: Can't allocate the swap slot bitmap");
+
+  size_t i;
+  for (i = 0; i < swap_size; i++)
+    free_words[i / WORD_BITS] |= 1u << (i % WORD_BITS);
+  for (i = 0; i < word_cnt; i++)
+    free_summary[i / WORD_BITS] |= 1u << (i % WORD_BITS);
+  cursor = 0;
+
+  lock_init (&swap_lock);
+  lock_init (&cluster_lock);
+  cluster_buffer = palloc_get_multiple (PAL_ASSERT, SWAP_CLUSTER);
 }
 
+/* Marks the CNT slots from SLOT on, all in the same word, as used (USED)
+ * or free, keeping the summary level up to date. */
+static void
+mark_slots (size_t slot, size_t cnt, bool used)
+{
+  size_t w = slot / WORD_BITS;
+  uint32_t mask = (cnt == WORD_BITS ? ~0u : ((1u << cnt) - 1)) << (slot % WORD_BITS);
 
-swap_index_t vm_swap_out (void *page)
+  ASSERT (slot % WORD_BITS + cnt <= WORD_BITS);
+  if (used) {
+    ASSERT ((free_words[w] & mask) == mask);
+    free_words[w] &= ~mask;
+    used_cnt += cnt;
+    if (used_cnt > max_used_cnt) max_used_cnt = used_cnt;
+  }
+  else {
+    ASSERT ((free_words[w] & mask) == 0);
+    free_words[w] |= mask;
+    used_cnt -= cnt;
+  }
+
+  if (free_words[w] != 0)
+    free_summary[w / WORD_BITS] |= 1u << (w % WORD_BITS);
+  else
+    free_summary[w / WORD_BITS] &= ~(1u << (w % WORD_BITS));
+}
+
+/* Returns the index of the first word at or after W (wrapping around)
+ * with a free slot, or word_cnt if there is none. */
+static size_t
+next_free_word (size_t w)
 {
-  // Ensure that the page is on user's virtual memory.
-  ASSERT (page >= PHYS_BASE);
+  size_t s = w / WORD_BITS;
+  uint32_t bits = free_summary[s] & (~0u << (w % WORD_BITS));
+  size_t i;
 
-  // Find an available block region to use
-  size_t swap_index = bitmap_scan (swap_available, /*start*/0, /*cnt*/1, true);
+  for (i = 0; i <= summary_cnt; i++) {
+    if (bits != 0)
+      return s * WORD_BITS + __builtin_ctz (bits);
+    s = (s + 1) % summary_cnt;
+    bits = free_summary[s];
+  }
+  return word_cnt;
+}
 
+/* Returns the bits of WORD that start a run of CNT set bits. */
+static uint32_t
+run_starts (uint32_t word, size_t cnt)
+{
   size_t i;
-  for (i = 0; i < SECTORS_PER_PAGE; ++ i) {
-    block_write(swap_block,
-        /* sector number */  swap_index * SECTORS_PER_PAGE + i,
-        /* target address */ page + (BLOCK_SECTOR_SIZE * i)
-        );
+  uint32_t starts = word;
+  for (i = 1; i < cnt; i++)
+    starts &= word >> i;
+  return starts;
+}
+
+/* Allocates up to CNT (at most WORD_BITS) contiguous free slots,
+ * preferring a run of CNT, and returns the first one, storing the
+ * number of slots obtained into *GOT.  Returns SIZE_MAX if the swap
+ * is full.  swap_lock must be held. */
+static size_t
+alloc_slots (size_t cnt, size_t *got)
+{
+  ASSERT (lock_held_by_current_thread (&swap_lock));
+  ASSERT (cnt > 0 && cnt <= WORD_BITS);
+
+  size_t first = next_free_word (cursor);
+  if (first == word_cnt)
+    return SIZE_MAX;
+
+  // next-fit, in a single pass over at most SCAN_WORDS words: the first
+  // one with a run of `cnt` free slots, or else the longest run (of
+  // `cnt` halved some times) among them.
+  size_t w = first, best_w = first, best_cnt = 0, best_ofs = 0, scanned;
+  for (scanned = 0; scanned < SCAN_WORDS; scanned++) {
+    size_t run;
+    for (run = cnt; run > best_cnt; run /= 2) {
+      uint32_t starts = run_starts (free_words[w], run);
+      if (starts != 0) {
+        best_w = w;
+        best_cnt = run;
+        best_ofs = __builtin_ctz (starts);
+        break;
+      }
+    }
+    if (best_cnt == cnt)
+      break;
+    w = next_free_word ((w + 1) % word_cnt);
+    if (w == first)
+      break;
   }
+  ASSERT (best_cnt > 0);
+
+  size_t slot = best_w * WORD_BITS + best_ofs;
+  mark_slots (slot, best_cnt, true);
+  cursor = best_w;
+  *got = best_cnt;
+  return slot;
+}
 
-  // occupy the slot: available becomes false
-  bitmap_set(swap_available, swap_index, false);
+/* Returns true if SLOT is free. */
+static bool
+slot_is_free (size_t slot)
+{
+  return (free_words[slot / WORD_BITS] >> (slot % WORD_BITS)) & 1;
+}
+
+
+swap_index_t vm_swap_out (void *page)
+{
+  swap_index_t swap_index;
+  if (vm_swap_out_multiple (&page, 1, &swap_index) == 0)
+    PANIC ("Error: swap is full");
   return swap_index;
 }
 
+size_t
+vm_swap_out_multiple (void *pages[], size_t cnt, swap_index_t swap_indexes[])
+{
+  size_t i, got;
+
+  for (i = 0; i < cnt; i += got) {
+    // Ensure that the page is on user's virtual memory.
+    ASSERT (pages[i] >= PHYS_BASE);
+
+    // Find available, preferably contiguous, block regions to use,
+    // and occupy them before writing to them.
+    size_t want = cnt - i < SWAP_CLUSTER ? cnt - i : SWAP_CLUSTER;
+    lock_acquire (&swap_lock);
+    size_t slot = alloc_slots (want, &got);
+    lock_release (&swap_lock);
+    if (slot == SIZE_MAX)
+      return i;
+
+    // write the pages with a single request, through the cluster
+    // buffer if there are several.
+    size_t j;
+    for (j = 0; j < got; j++)
+      swap_indexes[i + j] = slot + j;
+    if (got == 1)
+      block_write_multiple (swap_block, slot * SECTORS_PER_PAGE,
+                            SECTORS_PER_PAGE, pages[i]);
+    else {
+      lock_acquire (&cluster_lock);
+      for (j = 0; j < got; j++)
+        memcpy (cluster_buffer + j * PGSIZE, pages[i + j], PGSIZE);
+      block_write_multiple (swap_block, slot * SECTORS_PER_PAGE,
+                            got * SECTORS_PER_PAGE, cluster_buffer);
+      lock_release (&cluster_lock);
+    }
+    out_cnt += got;
+    out_write_cnt++;
+  }
+  return cnt;
+}
+
 
 void vm_swap_in (swap_index_t swap_index, void *page)
 {
@@ -62,20 +243,52 @@ void vm_swap_in (swap_index_t swap_index, void *page)
 
   // check the swap region
   ASSERT (swap_index < swap_size);
-  if (bitmap_test(swap_available, swap_index) == true) {
+  if (slot_is_free (swap_index)) {
     // still available slot, error
     PANIC ("Error, invalid read access to unassigned swap block");
   }
 
+  // read the whole page with a single request
+  block_read_multiple (swap_block, swap_index * SECTORS_PER_PAGE,
+                       SECTORS_PER_PAGE, page);
+  in_cnt++;
+
+  lock_acquire (&swap_lock);
+  mark_slots (swap_index, 1, false);
+  lock_release (&swap_lock);
+}
+
+void
+vm_swap_in_multiple (swap_index_t swap_index, size_t cnt, void *pages[])
+{
   size_t i;
-  for (i = 0; i < SECTORS_PER_PAGE; ++ i) {
-    block_read (swap_block,
-        /* sector number */  swap_index * SECTORS_PER_PAGE + i,
-        /* target address */ page + (BLOCK_SECTOR_SIZE * i)
-        );
+
+  ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER);
+  ASSERT (swap_index + cnt <= swap_size);
+  if (cnt == 1) {
+    vm_swap_in (swap_index, pages[0]);
+    return;
+  }
+
+  for (i = 0; i < cnt; i++) {
+    ASSERT (pages[i] >= PHYS_BASE);
+    if (slot_is_free (swap_index + i))
+      PANIC ("Error, invalid read access to unassigned swap block");
   }
 
-  bitmap_set(swap_available, swap_index, true);
+  // read the run with a single request, through the cluster buffer.
+  lock_acquire (&cluster_lock);
+  block_read_multiple (swap_block, swap_index * SECTORS_PER_PAGE,
+                       cnt * SECTORS_PER_PAGE, cluster_buffer);
+  for (i = 0; i < cnt; i++)
+    memcpy (pages[i], cluster_buffer + i * PGSIZE, PGSIZE);
+  lock_release (&cluster_lock);
+  in_cnt += cnt;
+
+  lock_acquire (&swap_lock);
+  for (i = 0; i < cnt; i++)
+    mark_slots (swap_index + i, 1, false);
+  lock_release (&swap_lock);
 }
 
 void
@@ -83,8 +296,98 @@ vm_swap_free (swap_index_t swap_index)
 {
   // check the swap region
   ASSERT (swap_index < swap_size);
-  if (bitmap_test(swap_available, swap_index) == true) {
+  if (slot_is_free (swap_index)) {
     PANIC ("Error, invalid free request to unassigned swap block");
   }
-  bitmap_set(swap_available, swap_index, true);
+  lock_acquire (&swap_lock);
+  mark_slots (swap_index, 1, false);
+  lock_release (&swap_lock);
+}
+
+void
+vm_swap_free_multiple (swap_index_t swap_indexes[], size_t cnt)
+{
+  size_t i, run;
+
+  lock_acquire (&swap_lock);
+  for (i = 0; i < cnt; i += run) {
+    ASSERT (swap_indexes[i] < swap_size);
+    if (slot_is_free (swap_indexes[i]))
+      PANIC ("Error, invalid free request to unassigned swap block");
+
+    // runs of consecutive slots within a word go at once.
+    for (run = 1; i + run < cnt; run++) {
+      swap_index_t slot = swap_indexes[i + run];
+      if (slot != swap_indexes[i] + run || slot % WORD_BITS == 0
+          || slot_is_free (slot))
+        break;
+    }
+    mark_slots (swap_indexes[i], run, false);
+  }
+  lock_release (&swap_lock);
+}
+
+/* Print swap statistics. */
+void
+vm_swap_print_stats (void)
+{
+  printf ("Swap: %zu slots, %zu used at most, %llu pages out in %llu writes, "
+          "%llu pages in\n",
+          swap_size, max_used_cnt, out_cnt, out_write_cnt, in_cnt);
+}
+
+/* Times swapping out SWAP_CLUSTER pages at a time, freeing them
+ * right after, with the swap empty and then 90% full (every tenth
+ * slot free), and prints the evictions per second of each. */
+void
+vm_swap_bench (char **argv UNUSED)
+{
+  void *pages[SWAP_CLUSTER];
+  swap_index_t indexes[SWAP_CLUSTER];
+  size_t rounds = swap_size / SWAP_CLUSTER;
+  uint8_t *buffer = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, SWAP_CLUSTER);
+  struct bitmap *filled = bitmap_create (swap_size);
+  size_t i, j;
+  int full;
+
+  for (i = 0; i < SWAP_CLUSTER; i++)
+    pages[i] = buffer + i * PGSIZE;
+
+  for (full = 0; full <= 90; full += 90) {
+    // fill the swap to `full` percent, spreading the free slots out.
+    lock_acquire (&swap_lock);
+    if (full > 0)
+      for (i = 0; i < swap_size; i++)
+        if (i % 10 != 0 && slot_is_free (i)) {
+          mark_slots (i, 1, true);
+          bitmap_mark (filled, i);
+        }
+    lock_release (&swap_lock);
+
+    unsigned long long writes = out_write_cnt;
+    int64_t start = timer_ticks ();
+    for (i = 0; i < rounds; i++) {
+      vm_swap_out_multiple (pages, SWAP_CLUSTER, indexes);
+      for (j = 0; j < SWAP_CLUSTER; j++)
+        vm_swap_free (indexes[j]);
+    }
+    int64_t ticks = timer_elapsed (start);
+
+    printf ("swapbench: %d%% full: %zu pages out in %llu writes, %"PRId64" ticks",
+            full, rounds * SWAP_CLUSTER, out_write_cnt - writes, ticks);
+    if (ticks > 0)
+      printf (" (%"PRId64" evictions/s)",
+              (int64_t) (rounds * SWAP_CLUSTER) * TIMER_FREQ / ticks);
+    printf ("\n");
+
+    lock_acquire (&swap_lock);
+    for (i = 0; i < swap_size; i++)
+      if (bitmap_test (filled, i))
+        mark_slots (i, 1, false);
+    bitmap_set_all (filled, false);
+    lock_release (&swap_lock);
+  }
+
+  bitmap_destroy (filled);
+  palloc_free_multiple (buffer, SWAP_CLUSTER);
 }
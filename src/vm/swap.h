@@ -1,8 +1,14 @@
 #ifndef VM_SWAP_H
 #define VM_SWAP_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef uint32_t swap_index_t;
 
+/* Maximum number of pages written to swap with a single request. */
+#define SWAP_CLUSTER 8
+
 
 /* Functions for Swap Table manipulation. */
 
@@ -14,19 +20,44 @@ void vm_swap_init (void);
 /**
  * Swap Out: write the content of `page` into the swap disk,
  * and return the index of swap region in which it is placed.
+ * Panics if the swap disk is full.
  */
 swap_index_t vm_swap_out (void *page);
 
+/**
+ * Swap Out several pages: write `cnt` pages into the swap disk,
+ * in as few requests as contiguous free swap slots allow, storing
+ * the swap index of each page into `swap_indexes`.
+ * Returns the number of pages written, the first ones of `pages`,
+ * which is less than `cnt` if the swap disk is full.
+ */
+size_t vm_swap_out_multiple (void *pages[], size_t cnt, swap_index_t swap_indexes[]);
+
 /**
  * Swap In: read the content of from the specified swap index,
  * from the mapped swap block, and store PGSIZE bytes into `page`.
  */
 void vm_swap_in (swap_index_t swap_index, void *page);
 
+/**
+ * Swap In several pages: read the `cnt` (at most SWAP_CLUSTER) pages in
+ * the contiguous swap slots from `swap_index` on with a single request,
+ * storing them into `pages`.
+ */
+void vm_swap_in_multiple (swap_index_t swap_index, size_t cnt, void *pages[]);
+
 /**
  * Free Swap: drop the swap region.
  */
 void vm_swap_free (swap_index_t swap_index);
 
+/**
+ * Free Swap in bulk: drop the `cnt` swap regions in `swap_indexes`.
+ */
+void vm_swap_free_multiple (swap_index_t swap_indexes[], size_t cnt);
+
+void vm_swap_print_stats (void);
+void vm_swap_bench (char **argv);
+
 
 #endif /* vm/swap.h */
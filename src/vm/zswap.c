@@ -0,0 +1,166 @@
+#include <bitmap.h>
+#include <lzf.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/zswap.h"
+
+size_t vm_zswap_pages = 32;
+
+/* The pool is divided into chunks; a compressed page takes a run of
+ * them, the first two bytes holding its compressed size. */
+#define ZSWAP_CHUNK 64
+#define HEADER_SIZE 2
+
+// pages must compress to this size or below to be worth keeping.
+#define MAX_COMPRESSED (PGSIZE * 3 / 4)
+
+static uint8_t *pool;
+static struct bitmap *used_chunks;
+static size_t chunk_cnt;
+
+// protects the pool, and the compression buffers below (kept out of
+// the kernel stacks, which are too small for them).
+static struct lock zswap_lock;
+static uint16_t htab[LZF_HTAB_SIZE];
+static uint8_t buffer[MAX_COMPRESSED];
+
+// statistics
+static size_t stored_cnt, max_stored_cnt;
+static unsigned long long out_cnt, out_bytes, in_cnt;
+static unsigned long long incompressible_cnt, full_cnt;
+
+void
+vm_zswap_init (void)
+{
+  if (vm_zswap_pages == 0)
+    return;
+
+  pool = palloc_get_multiple (0, vm_zswap_pages);
+  if (pool == NULL) {
+    printf ("zswap: can't allocate %zu pages, running without\n",
+            vm_zswap_pages);
+    vm_zswap_pages = 0;
+    return;
+  }
+  chunk_cnt = vm_zswap_pages * PGSIZE / ZSWAP_CHUNK;
+  used_chunks = bitmap_create (chunk_cnt);
+  if (used_chunks == NULL)
+    PANIC ("Error: Can't allocate the compressed swap bitmap");
+  lock_init (&zswap_lock);
+}
+
+/* Returns the number of chunks taken by a page compressed to SIZE bytes. */
+static size_t
+chunks_for (size_t size)
+{
+  return DIV_ROUND_UP (HEADER_SIZE + size, ZSWAP_CHUNK);
+}
+
+/* Returns the compressed size of the page at INDEX. */
+static size_t
+stored_size (zswap_index_t index)
+{
+  uint16_t size;
+  memcpy (&size, pool + index * ZSWAP_CHUNK, sizeof size);
+  return size;
+}
+
+/* Drops the page at INDEX.  zswap_lock must be held. */
+static void
+release (zswap_index_t index)
+{
+  ASSERT (lock_held_by_current_thread (&zswap_lock));
+  ASSERT (index < chunk_cnt && bitmap_test (used_chunks, index));
+
+  size_t size = stored_size (index);
+  bitmap_set_multiple (used_chunks, index, chunks_for (size), false);
+  stored_cnt--;
+}
+
+bool
+vm_zswap_out (void *page, zswap_index_t *index)
+{
+  if (pool == NULL)
+    return false;
+
+  lock_acquire (&zswap_lock);
+  size_t size = lzf_compress (page, PGSIZE, buffer, sizeof buffer, htab);
+  if (size == 0) {
+    incompressible_cnt++;
+    lock_release (&zswap_lock);
+    return false;
+  }
+
+  size_t first = bitmap_scan_and_flip (used_chunks, 0, chunks_for (size), false);
+  if (first == BITMAP_ERROR) {
+    full_cnt++;
+    lock_release (&zswap_lock);
+    return false;
+  }
+
+  uint16_t header = size;
+  memcpy (pool + first * ZSWAP_CHUNK, &header, HEADER_SIZE);
+  memcpy (pool + first * ZSWAP_CHUNK + HEADER_SIZE, buffer, size);
+
+  stored_cnt++;
+  if (stored_cnt > max_stored_cnt) max_stored_cnt = stored_cnt;
+  out_cnt++;
+  out_bytes += size;
+  lock_release (&zswap_lock);
+
+  *index = first;
+  return true;
+}
+
+void
+vm_zswap_in (zswap_index_t index, void *page)
+{
+  lock_acquire (&zswap_lock);
+  ASSERT (index < chunk_cnt && bitmap_test (used_chunks, index));
+
+  size_t size = stored_size (index);
+  if (lzf_decompress (pool + index * ZSWAP_CHUNK + HEADER_SIZE, size,
+                      page, PGSIZE) != PGSIZE)
+    PANIC ("Error, corrupt page in the compressed swap");
+  release (index);
+  in_cnt++;
+  lock_release (&zswap_lock);
+}
+
+void
+vm_zswap_free (zswap_index_t index)
+{
+  lock_acquire (&zswap_lock);
+  release (index);
+  lock_release (&zswap_lock);
+}
+
+void
+vm_zswap_free_multiple (zswap_index_t indexes[], size_t cnt)
+{
+  size_t i;
+
+  if (cnt == 0)
+    return;
+  lock_acquire (&zswap_lock);
+  for (i = 0; i < cnt; i++)
+    release (indexes[i]);
+  lock_release (&zswap_lock);
+}
+
+/* Print compressed swap statistics. */
+void
+vm_zswap_print_stats (void)
+{
+  if (pool == NULL)
+    return;
+  printf ("Compressed swap: %zu pages pool, %zu pages stored at most, "
+          "%llu pages out (%llu bytes), %llu pages in, "
+          "%llu spilled to disk (%llu incompressible, %llu pool full)\n",
+          vm_zswap_pages, max_stored_cnt, out_cnt, out_bytes, in_cnt,
+          incompressible_cnt + full_cnt, incompressible_cnt, full_cnt);
+}
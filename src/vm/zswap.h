@@ -0,0 +1,47 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t zswap_index_t;
+
+/* Functions for the compressed swap, an in-memory tier in front of
+ * the swap disk: evicted pages are kept compressed in a bounded pool
+ * of kernel pages, and only go to the swap disk once it is full. */
+
+/* Size of the pool, in pages (0: no compressed swap). */
+extern size_t vm_zswap_pages;
+
+/**
+ * Initialize the compressed swap. Must be called ONLY ONCE at the
+ * initialization phase.
+ */
+void vm_zswap_init (void);
+
+/**
+ * Compress `page` into the pool, storing where it went into `index`.
+ * Returns false, leaving the page to the swap disk, if it does not
+ * compress well or the pool is full.
+ */
+bool vm_zswap_out (void *page, zswap_index_t *index);
+
+/**
+ * Decompress the page at `index` into `page`, and drop it from the pool.
+ */
+void vm_zswap_in (zswap_index_t index, void *page);
+
+/**
+ * Drop the page at `index` from the pool.
+ */
+void vm_zswap_free (zswap_index_t index);
+
+/**
+ * Drop the `cnt` pages at `indexes` from the pool, all at once.
+ */
+void vm_zswap_free_multiple (zswap_index_t indexes[], size_t cnt);
+
+void vm_zswap_print_stats (void);
+
+#endif /* vm/zswap.h */